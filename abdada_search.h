@@ -3,17 +3,39 @@
 #include <thread>
 #include <functional>
 #include "locking_tt.h"
+#include "accumulator.h"
+#include "eval_cache.h"
+#include "move_picker.h"
+#include "move_ordering.h"
+#include "selective_search.h"
+#include "search_base.h"
+#include "quiescence_search.h"
+#include "aspiration.h"
+#include "multipv.h"
 #include "abdada_tt.h"
 #include "compile_time_constants.h"
 
-template<bool Q_SEARCH, TT_Strategy strategy>
-class alignas (128) ABDADA_Thread { // Let's go big with the alignas just in case
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
+class alignas (128) ABDADA_Thread // Let's go big with the alignas just in case
+        : public Search_Base<ABDADA_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>, ABDADA_TT_Info, MOVE_ORDERING,
+                             SELECTIVE> {
 
 private:
+    using Base = Search_Base<ABDADA_Thread, ABDADA_TT_Info, MOVE_ORDERING, SELECTIVE>;
+    friend Base;
+    using Base::beta_cutoff, Base::make_null_move, Base::unmake_null_move, Base::late_move_reduction,
+            Base::q_tt_probe, Base::q_tt_store, Base::next_capture, Base::prune_capture;
+
     Board board;
     uint64_t nodes = 0;
+    Accumulator_Stack accumulators;
+    Eval_Cache eval_cache;
+    Move_Ordering move_ordering;
+    Selective_Stats selective_stats;
+    Q_Search_Stats q_search_stats;
     ABDADA_TT<strategy>& tt;
     std::atomic<bool>& finished;
+    Root_Moves* root_order = nullptr; // Set if the driver keeps the root move order across iterations
 
     /**
      *
@@ -82,13 +104,96 @@ private:
         }
     }
 
+    inline Move next_move(Staged_Move_Picker& picker) {
+        return picker.next<MOVE_ORDERING>([this](Movelist& moves) {
+            generate_shuffled_moves<ALL>(moves);
+            if constexpr (MOVE_ORDERING) {
+                move_ordering.score(board, moves);
+            }
+        });
+    }
+
+    inline void make_move(Move move) {
+        if constexpr (MOVE_ORDERING) {
+            move_ordering.push(board, move);
+        }
+        if constexpr (USE_ACCUMULATOR) {
+            accumulators.make_move(board, move);
+        } else {
+            board.makeMove(move);
+        }
+    }
+
+    inline void unmake_move(Move move) {
+        if constexpr (USE_ACCUMULATOR) {
+            accumulators.unmake_move(board, move);
+        } else {
+            board.unmakeMove(move);
+        }
+        if constexpr (MOVE_ORDERING) {
+            move_ordering.pop();
+        }
+    }
+
+    /**
+     * The q-search slot of the TT, for q_tt_probe and q_tt_store of the base.
+     */
+    inline bool q_tt_get(ABDADA_TT_Info& entry) {
+        return tt.template get_if_exists<false>(board.hashKey, Q_SEARCH_TT_DEPTH, entry, false);
+    }
+
+    inline void q_tt_put(ABDADA_TT_Info& entry) {
+        tt.template emplace<false>(board.hashKey, entry, Q_SEARCH_TT_DEPTH);
+    }
+
+    inline void record_root_move(Move move, uint64_t subtree_nodes, Eval_Type eval) {
+        if (root_order != nullptr) {
+            root_order->record(move, subtree_nodes, eval);
+        }
+    }
+
+    inline Eval_Type evaluate() {
+        Eval_Type eval;
+        if constexpr (Eval_Cache::ENABLED) {
+            if (eval_cache.probe(board.hashKey, eval)) {
+                return eval;
+            }
+        }
+        if constexpr (USE_ACCUMULATOR) {
+            eval = accumulators.evaluate(board);
+        } else {
+            eval = board.eval();
+        }
+        if constexpr (Eval_Cache::ENABLED) {
+            eval_cache.store(board.hashKey, eval);
+        }
+        return eval;
+    }
+
 public:
     explicit ABDADA_Thread(Board& board, ABDADA_TT<strategy>& table, std::atomic<bool>& finished)
                                                     : board(board), tt(table), finished(finished) {
+        accumulators.refresh(this->board);
+    }
+
+    void set_root_order(Root_Moves* order) {
+        root_order = order;
+    }
+
+    [[nodiscard]] const Eval_Cache& get_eval_cache() const {
+        return eval_cache;
+    }
+
+    [[nodiscard]] const Selective_Stats& get_selective_stats() const {
+        return selective_stats;
+    }
+
+    [[nodiscard]] const Q_Search_Stats& get_q_search_stats() const {
+        return q_search_stats;
     }
 
     Eval_Type q_search(Eval_Type alpha, Eval_Type beta) {
-        Eval_Type q_eval = board.eval();
+        Eval_Type q_eval = evaluate();
         if (q_eval < MIN_EVAL) { // Avoid overflow issues when inverting the eval.
             q_eval = MIN_EVAL;
         }
@@ -97,26 +202,44 @@ public:
             return q_eval;
         }
 
-        if (q_eval >= beta) {
+        if (q_eval >= beta) { // Stand pat, checked before the TT probe since this is where most q-nodes end
             return q_eval;
         }
+        Move tt_move = NO_MOVE;
+        if (q_tt_probe(tt_move, alpha, beta)) { // I.e. if cutoff
+            return alpha; // TT entry value is put here
+        }
+        if (q_eval >= beta) { // The TT probe might have lowered beta
+            return q_eval;
+        }
+
+        ABDADA_TT_Info entry{q_eval, tt_move, (int8_t) Q_SEARCH_TT_DEPTH, UPPER_BOUND, 0};
         if (q_eval > alpha) {
             alpha = q_eval;
+            entry.type = EXACT;
         }
 
-        Movelist captures;
-        Movegen::legalmoves<CAPTURE>(board, captures);
-        for (auto& capture : captures) {
-            board.makeMove(capture.move);
+        Eval_Type stand_pat = q_eval;
+        int capture_count = 0;
+        Staged_Move_Picker picker(board, tt_move);
+        for (Move capture = next_capture(picker); capture != NO_MOVE; capture = next_capture(picker)) {
+            capture_count++;
+            if (prune_capture(capture, stand_pat, alpha, q_eval)) {
+                continue;
+            }
+            make_move(capture);
             Eval_Type inner_eval = -q_search(-beta, -alpha);
-            board.unmakeMove(capture.move);
+            unmake_move(capture);
             if (inner_eval > q_eval) {
                 q_eval = inner_eval;
+                entry.move = capture;
                 if (q_eval >= beta) {
+                    entry.type = LOWER_BOUND;
                     break;
                 }
                 if (q_eval > alpha) {
                     alpha = q_eval;
+                    entry.type = EXACT;
                 }
             }
             if (finished) { // If someone else already completed the search there is no reason for us to continue
@@ -124,11 +247,14 @@ public:
             }
         }
 
+        if (capture_count > 0) { // Without captures the entry would save nothing but the move generation
+            q_tt_store(entry, q_eval);
+        }
         return q_eval;
     }
 
     Eval_Type nw_q_search(Eval_Type beta) {
-        Eval_Type q_eval = board.eval();
+        Eval_Type q_eval = evaluate();
         if (q_eval < MIN_EVAL) { // Avoid overflow issues when inverting the eval.
             q_eval = MIN_EVAL;
         }
@@ -137,19 +263,32 @@ public:
             return q_eval;
         }
 
-        if (q_eval >= beta) {
+        if (q_eval >= beta) { // Stand pat, checked before the TT probe since this is where most q-nodes end
             return q_eval;
         }
+        Move tt_move = NO_MOVE;
+        Eval_Type alpha = beta - 1;
+        if (q_tt_probe(tt_move, alpha, beta)) { // I.e. if cutoff
+            return alpha; // TT entry value is put here
+        }
 
-        Movelist captures;
-        Movegen::legalmoves<CAPTURE>(board, captures);
-        for (auto& capture : captures) {
-            board.makeMove(capture.move);
+        ABDADA_TT_Info entry{q_eval, tt_move, (int8_t) Q_SEARCH_TT_DEPTH, UPPER_BOUND, 0};
+        Eval_Type stand_pat = q_eval;
+        int capture_count = 0;
+        Staged_Move_Picker picker(board, tt_move);
+        for (Move capture = next_capture(picker); capture != NO_MOVE; capture = next_capture(picker)) {
+            capture_count++;
+            if (prune_capture(capture, stand_pat, alpha, q_eval)) {
+                continue;
+            }
+            make_move(capture);
             Eval_Type inner_eval = -nw_q_search(-beta + 1);
-            board.unmakeMove(capture.move);
+            unmake_move(capture);
             if (inner_eval > q_eval) {
                 q_eval = inner_eval;
+                entry.move = capture;
                 if (q_eval >= beta) {
+                    entry.type = LOWER_BOUND;
                     break;
                 }
             }
@@ -158,10 +297,13 @@ public:
             }
         }
 
+        if (capture_count > 0) { // Without captures the entry would save nothing but the move generation
+            q_tt_store(entry, q_eval);
+        }
         return q_eval;
     }
 
-    Eval_Type null_window_search(Eval_Type beta, int depth, bool exclusive) {
+    Eval_Type null_window_search(Eval_Type beta, int depth, bool exclusive = false, bool allow_null_move = true) {
         Eval_Type eval = MIN_EVAL - MAX_MATE_DEPTH;
         Move tt_move = NO_MOVE;
         Eval_Type alpha = beta - 1;
@@ -170,42 +312,61 @@ public:
         }
 
         ABDADA_TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND, 0}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        generate_shuffled_moves<ALL>(moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE;
+        if constexpr (SELECTIVE) {
+            if (allow_null_move && depth >= NULL_MOVE_MIN_DEPTH && !board.in_check() && has_non_pawn_material(board)
+                && evaluate() >= beta) {
+                int null_move_depth = depth - 1 - null_move_reduction(depth);
+                make_null_move();
+                Eval_Type null_move_eval = null_move_depth > 0 ? -null_window_search(-beta + 1, null_move_depth, false, false)
+                                                               : -nw_q_search(-beta + 1);
+                unmake_null_move();
+                if (finished) { // The null move search got aborted, so its result means nothing
+                    tt.decrement_proc(board.hashKey, depth); // We stop searching
+                    return null_move_eval;
+                }
+                if (null_move_eval >= beta) { // Even passing is good enough, so some real move most likely is too
+                    selective_stats.null_move_prunes[depth]++;
+                    entry.eval = null_move_eval > MAX_EVAL ? beta : null_move_eval; // Don't trust mate scores here
+                    entry.type = LOWER_BOUND;
+                    tt.template emplace<true>(board.hashKey, entry, depth);
+                    return entry.eval;
+                }
             }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
         }
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        bool in_check = SELECTIVE && board.in_check(); // Moves out of check are never reduced
 
-        std::vector<Move> deferred_moves{};
-        deferred_moves.reserve(moves.size);
+        std::vector<Move> deferred_moves{}; // No reserve, so this only allocates once something actually gets deferred
 
-        for (int move_index = 0; move_index < moves.size; move_index++) {
-            Move move = moves[move_index].move;
-            board.makeMove(move);
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            int move_index = move_count++;
+            bool quiet = board.board[to(move)] == None;
+            make_move(move);
+            int reduction = late_move_reduction(depth, move_count, quiet, in_check);
             Eval_Type inner_eval;
             if (depth > 1) {
-                inner_eval = -null_window_search(-beta + 1, depth - 1, move_index != 0);
+                inner_eval = -null_window_search(-beta + 1, depth - 1 - reduction, move_index != 0);
                 if (inner_eval == (Eval_Type) -ON_EVALUATION) { // The overflow behavior here is questionable but works for these values
                     deferred_moves.emplace_back(move);
+                } else if (reduction > 0) {
+                    selective_stats.reductions[depth]++;
+                    if (inner_eval >= beta) { // The reduced search could not refute the move, so verify at full depth
+                        selective_stats.re_searches[depth]++;
+                        inner_eval = -null_window_search(-beta + 1, depth - 1, false);
+                    }
                 }
             } else {
                 inner_eval = -nw_q_search(-beta + 1);
             }
-            board.unmakeMove(move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
                 entry.move = move;
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
             }
@@ -215,17 +376,25 @@ public:
             }
         }
 
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
+
         for (Move move : deferred_moves) { // In particular no leaf is deferred so there's always a search to be done here
-            board.makeMove(move);
+            make_move(move);
             Eval_Type inner_eval;
             inner_eval = -null_window_search(-beta + 1, depth - 1, false);
-            board.unmakeMove(move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
                 entry.move = move;
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
             }
@@ -248,35 +417,32 @@ public:
         }
 
         ABDADA_TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND, 0}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        generate_shuffled_moves<ALL>(moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE;
-            }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
-        }
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        bool in_check = SELECTIVE && board.in_check(); // Moves out of check are never reduced
 
-        std::vector<Move> deferred_moves{};
-        deferred_moves.reserve(moves.size);
+        std::vector<Move> deferred_moves{}; // No reserve, so this only allocates once something actually gets deferred
 
         bool search_full_window = true; // TODO can this be removed?
-        for (int move_index = 0; move_index < moves.size; move_index++) {
-            Move move = moves[move_index].move;
-            board.makeMove(move);
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            bool quiet = board.board[to(move)] == None;
+            make_move(move);
+            int reduction = late_move_reduction(depth, move_count, quiet, in_check);
             Eval_Type inner_eval = MAX_EVAL; // Hack so that further down below inner eval is bigger than alpha if no search was done
             if (depth == 1) {
                 inner_eval = -q_search(-beta, -alpha);
             } else {
                 if (!search_full_window) {
-                    inner_eval = -null_window_search(-alpha, depth - 1, true);
+                    inner_eval = -null_window_search(-alpha, depth - 1 - reduction, true);
                     if (inner_eval == (Eval_Type) -ON_EVALUATION) {
                         deferred_moves.emplace_back(move);
+                    } else if (reduction > 0) {
+                        selective_stats.reductions[depth]++;
+                        if (inner_eval > alpha) { // The reduced search could not refute the move, so verify at full depth
+                            selective_stats.re_searches[depth]++;
+                            inner_eval = -null_window_search(-alpha, depth - 1, false);
+                        }
                     }
                 }
                 if (inner_eval > alpha) {
@@ -284,13 +450,14 @@ public:
                     search_full_window = false;
                 }
             }
-            board.unmakeMove(move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
                 entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -305,19 +472,27 @@ public:
             }
         }
 
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
+
         for (auto& move : deferred_moves) { // We never enter this at depth 1, also never search full window right away.
-            board.makeMove(move);
+            make_move(move);
             Eval_Type inner_eval = -null_window_search(-alpha, depth - 1, false);
             if (inner_eval > alpha) {
                 inner_eval = -pv_search(-beta, -alpha, depth - 1);
             }
-            board.unmakeMove(move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
                 entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -357,34 +532,25 @@ public:
         }
 
         Locked_TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        generate_shuffled_moves<ALL>(moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE;
-            }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
-        }
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            make_move(move);
             Eval_Type inner_eval;
             if (depth > 1) {
                 inner_eval = -nega_max(-beta, -alpha, depth - 1);
             } else {
                 inner_eval = -q_search(-beta, -alpha);
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move; // If it stays this way, this is the best move
+                entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -398,6 +564,12 @@ public:
                 }
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -413,11 +585,15 @@ public:
             return; // I'm claiming that if this happens, then we already have a search result from another thread, so we don't need to return anything
         }
 
+        Eval_Type root_alpha = alpha; // The window might not be the full one, so the result can be a bound
         Movelist moves;
         generate_shuffled_moves<ALL>(moves);
+        if (root_order != nullptr) {
+            root_order->sort(moves); // The same order in all threads, from the previous iteration
+        }
         int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
+        if (tt_move_index > 0) { // Search the TT move first, the others keep the shared order
+            std::rotate(moves.begin(), moves.begin() + tt_move_index, moves.begin() + tt_move_index + 1);
         }
 
         std::vector<Move> deferred_moves{};
@@ -428,7 +604,8 @@ public:
         bool search_full_window = true;
         for (int move_index = 0; move_index < moves.size; move_index++) {
             Move move = moves[move_index].move;
-            board.makeMove(move);
+            uint64_t nodes_before = nodes;
+            make_move(move);
             Eval_Type inner_eval = MAX_EVAL;
             if (depth == 1) {
                 inner_eval = -q_search(-beta, -alpha);
@@ -463,7 +640,10 @@ public:
                 tt.print_pv(board, depth - 1);
                 tt.print_size();
             }
-            board.unmakeMove(move);
+            unmake_move(move);
+            if (inner_eval != (Eval_Type) -ON_EVALUATION) { // A deferred move gets recorded once it is searched below
+                record_root_move(move, nodes - nodes_before, inner_eval);
+            }
 
             if (inner_eval > eval) {
                 eval = inner_eval;
@@ -484,7 +664,8 @@ public:
         }
 
         for (Move move : deferred_moves) {
-            board.makeMove(move);
+            uint64_t nodes_before = nodes;
+            make_move(move);
             Eval_Type inner_eval = MAX_EVAL;
             if constexpr (!PV_Search) {
                 //inner_eval = -nega_max(-beta, -alpha, depth - 1);
@@ -500,7 +681,8 @@ public:
                 tt.print_pv(board, depth - 1);
                 tt.print_size();
             }
-            board.unmakeMove(move);
+            unmake_move(move);
+            record_root_move(move, nodes - nodes_before, inner_eval);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
@@ -521,7 +703,7 @@ public:
         }
 
 
-        tt.template emplace<true>(board.hashKey, {eval, best_move, (int8_t) depth, EXACT, 0}, depth);
+        tt.template emplace<true>(board.hashKey, {eval, best_move, (int8_t) depth, root_bound_type(eval, root_alpha, beta), 0}, depth);
 
         bool i_am_first = !finished.exchange(true);
 
@@ -529,46 +711,114 @@ public:
             result.move = best_move;
             result.eval = eval;
             result.depth = depth;
-            tt.print_pv(board, depth);
         }
         total_node_count += nodes;
     }
 };
 
-template<bool Q_SEARCH, TT_Strategy strategy>
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
 class ABDADA_Search {
 
     std::atomic<bool> finished = false;
     size_t num_threads;
-    std::vector<ABDADA_Thread<Q_SEARCH, strategy>> searchers;
+    Aspiration_Stats aspiration_stats;
+    uint64_t total_nodes = 0; // Over all iterations of all searches so far
+    std::vector<ABDADA_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>> searchers;
+    Board& board;
+    ABDADA_TT<strategy>& table;
 
+    Root_Moves root_order;
 public:
     ABDADA_Search(size_t num_threads, Board& board, ABDADA_TT<strategy>& table) : num_threads(num_threads),
-                                      searchers(num_threads, ABDADA_Thread<Q_SEARCH, strategy>(board, table, finished)) {
+                                      searchers(num_threads, ABDADA_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>(board, table, finished)),
+                    board(board), table(table),
+                    root_order(board) {
+        for (auto& searcher : searchers) {
+            searcher.set_root_order(&root_order);
+        }
+    }
+
+    [[nodiscard]] const Aspiration_Stats& get_aspiration_stats() const {
+        return aspiration_stats;
+    }
+
+    [[nodiscard]] uint64_t get_total_nodes() const {
+        return total_nodes;
     }
 
     /**
      *
      * @tparam Search_Result
      * @tparam PV_Search
+     * @tparam OUTPUT Print the result and the stats of every iteration. Bench turns this off.
      * @param up_to_depth Search for each depth from 1 to up_to_depth through iterative deepening.
      * @param iteration Optional parameter, if passed will be printed in the output. Useful for automated benchmarks.
      * @return
      */
-    template<class Search_Result, bool PV_Search>
+    template<class Search_Result, bool PV_Search, bool OUTPUT = true>
     Search_Result parallel_search(int up_to_depth, int iteration = 0) {
         Search_Result result;
         for (int depth = 1; depth <= up_to_depth; depth++) {
-            std::vector<std::thread> search_threads;
-            Eval_Type alpha = MIN_EVAL - MAX_MATE_DEPTH - 1;
-            Eval_Type beta = MAX_EVAL + MAX_MATE_DEPTH + 1;
-            finished = false;
+            Aspiration_Window window(result.eval, depth); // The score of the previous iteration
             std::atomic<uint64_t > node_count = 0;
             auto start = std::chrono::high_resolution_clock::now();
-            for (size_t i = 0; i < num_threads; i++) {
-                auto func = std::bind(&ABDADA_Thread<Q_SEARCH, strategy>::template root_max<Search_Result, PV_Search>,
-                                      &searchers[i], alpha, beta, depth, std::ref(result), std::ref(node_count));
-                search_threads.emplace_back(func);
+            do {
+                std::vector<std::thread> search_threads;
+                finished = false;
+                for (size_t i = 0; i < num_threads; i++) {
+                    auto func = std::bind(&ABDADA_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>::template root_max<Search_Result, PV_Search>,
+                                          &searchers[i], window.alpha, window.beta, depth, std::ref(result), std::ref(node_count));
+                    search_threads.emplace_back(func);
+                }
+                for (auto &thread: search_threads) {
+                    thread.join();
+                }
+            } while (window.widen(result.eval, aspiration_stats));
+            root_order.next_iteration(result.move);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+
+            result.duration = duration.count();
+            result.nodes = node_count;
+            total_nodes += result.nodes;
+            if constexpr (OUTPUT) {
+                result.print_table(iteration, num_threads);
+                table.print_pv(board, depth);
+                if constexpr (Eval_Cache::ENABLED) {
+                    print_eval_cache_stats(searchers);
+                }
+                if constexpr (Q_SEARCH) {
+                    print_q_search_stats(searchers);
+                }
+                if constexpr (SELECTIVE) {
+                    print_selective_stats(searchers, depth);
+                }
+                if (USE_ASPIRATION_WINDOWS && depth >= ASPIRATION_MIN_DEPTH) {
+                    aspiration_stats.print(depth);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Iterative deepening where the best multi_pv root moves all get exact scores. The root moves are shared by all
+     * threads and get reordered by their scores between iterations.
+     */
+    template<class Search_Result, bool PV_Search>
+    Search_Result multipv_search(int up_to_depth, size_t multi_pv) {
+        Search_Result result;
+        Root_Moves root_moves(board, multi_pv);
+        for (int depth = 1; depth <= up_to_depth && root_moves.size() > 0; depth++) {
+            root_moves.start_iteration();
+            std::atomic<uint64_t > node_count = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> search_threads;
+            finished = false;
+            for (auto& searcher : searchers) {
+                search_threads.emplace_back([&, &searcher = searcher] {
+                    searcher.template multipv_root_max<true>(root_moves, depth, node_count); // There is no nega_max here
+                });
             }
             for (auto &thread: search_threads) {
                 thread.join();
@@ -576,9 +826,13 @@ public:
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> duration = end - start;
 
+            Root_Move best = root_moves.best()[0];
+            result.move = best.move;
+            result.eval = best.score;
+            result.depth = depth;
             result.duration = duration.count();
             result.nodes = node_count;
-            result.print_table(iteration, num_threads);
+            root_moves.print(board, table, depth, result.nodes, result.duration);
         }
         return result;
     }
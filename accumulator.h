@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+
+constexpr int ACCUMULATOR_WIDTH = 16; // 16 int16 lanes, i.e. exactly one AVX2 register
+
+/**
+ * GCC/Clang vector extension, with -march=native an addition or subtraction of two of these is a single SIMD instruction.
+ */
+typedef int16_t Feature_Vector __attribute__((vector_size(ACCUMULATOR_WIDTH * sizeof(int16_t))));
+
+/**
+ * The lanes of the feature vector that are currently in use. Anything from FIRST_FREE_LANE onwards is zero and can be
+ * used by further piece-square features, e.g. the hidden layer of a small linear model.
+ */
+enum Feature_Lane {
+    MIDGAME_LANE, ENDGAME_LANE, PHASE_LANE, FIRST_FREE_LANE
+};
+
+/**
+ * For each perspective, piece and square the feature vector that piece on that square adds to the accumulator.
+ * The black perspective uses the color flipped piece on the vertically mirrored square, so that for a symmetric
+ * table the black accumulator is exactly the negated white one.
+ */
+class Feature_Table {
+
+public:
+    Feature_Table() {
+        for (int piece = WhitePawn; piece <= BlackKing; piece++) {
+            int flipped_piece = (piece + 6) % 12;
+            for (int square = 0; square < 64; square++) {
+                Feature_Vector& white = features[White][piece][square];
+                white[MIDGAME_LANE] = midgame_table[piece][square];
+                white[ENDGAME_LANE] = endgame_table[piece][square];
+                white[PHASE_LANE] = (int16_t) gamephase_influence[piece];
+
+                Feature_Vector& black = features[Black][piece][square];
+                black[MIDGAME_LANE] = midgame_table[flipped_piece][square ^ 56];
+                black[ENDGAME_LANE] = endgame_table[flipped_piece][square ^ 56];
+                black[PHASE_LANE] = (int16_t) gamephase_influence[piece];
+            }
+        }
+    }
+
+    [[nodiscard]] inline const Feature_Vector& at(int perspective, int piece, int square) const {
+        return features[perspective][piece][square];
+    }
+
+private:
+    alignas(64) Feature_Vector features[2][12][64]{};
+};
+
+const Feature_Table pst_features;
+
+/**
+ * Keeps one accumulator per ply. Making a move copies the current accumulator one ply up and applies the feature
+ * differences of the pieces that changed; unmaking a move only decrements the ply, so nothing gets recomputed.
+ * Which pieces changed is read off the piece bitboards before and after the move, that way castling, en passant and
+ * promotions need no special handling.
+ */
+class Accumulator_Stack {
+
+private:
+    struct alignas(64) Accumulator {
+        Feature_Vector perspective[2];
+    };
+
+    Accumulator stack[MAX_PLY]{};
+    int ply = 0;
+
+    inline void add(Accumulator& accumulator, int piece, int square) {
+        accumulator.perspective[White] += pst_features.at(White, piece, square);
+        accumulator.perspective[Black] += pst_features.at(Black, piece, square);
+    }
+
+    inline void sub(Accumulator& accumulator, int piece, int square) {
+        accumulator.perspective[White] -= pst_features.at(White, piece, square);
+        accumulator.perspective[Black] -= pst_features.at(Black, piece, square);
+    }
+
+public:
+    /**
+     * Recomputes the accumulator from scratch and resets the stack, this should be called for the root position.
+     */
+    void refresh(const Board& board) {
+        ply = 0;
+        Accumulator& root = stack[0];
+        root = {};
+        for (int square = 0; square < 64; square++) {
+            Piece piece = board.board[square];
+            if (piece != None) {
+                add(root, piece, square);
+            }
+        }
+    }
+
+    void make_move(Board& board, Move move) {
+        uint64_t before[12];
+        std::memcpy(before, board.piecesBB, sizeof(before));
+        board.makeMove(move);
+
+        assert(ply + 1 < MAX_PLY);
+        Accumulator& next = stack[ply + 1];
+        next = stack[ply];
+        ply++;
+        for (int piece = WhitePawn; piece <= BlackKing; piece++) {
+            uint64_t changed = before[piece] ^ board.piecesBB[piece];
+            if (changed == 0) { // Usually only one or two pieces change
+                continue;
+            }
+            for (uint64_t removed = changed & before[piece]; removed; removed &= removed - 1) {
+                sub(next, piece, std::countr_zero(removed));
+            }
+            for (uint64_t added = changed & board.piecesBB[piece]; added; added &= added - 1) {
+                add(next, piece, std::countr_zero(added));
+            }
+        }
+    }
+
+    void unmake_move(Board& board, Move move) {
+        board.unmakeMove(move);
+        ply--;
+    }
+
+    /**
+     * Same interpolation as Incremental_PST, from the side to moves perspective.
+     */
+    Eval_Type evaluate(Board& board) const {
+        const Feature_Vector& features = stack[ply].perspective[board.sideToMove];
+        int total_weight = 24;
+        int midgame_weight = std::min((int) features[PHASE_LANE], total_weight);
+        int endgame_weight = total_weight - midgame_weight;
+        Eval_Type eval = (features[MIDGAME_LANE] * midgame_weight + features[ENDGAME_LANE] * endgame_weight) / total_weight;
+        assert(eval == board.eval<Board::Full_PST>());
+        return eval;
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include "compile_time_constants.h"
+#include "transposition_table.h"
+
+constexpr bool USE_ASPIRATION_WINDOWS = true;
+constexpr int ASPIRATION_MIN_DEPTH = 4; // Below this the previous score is too unreliable and the search too cheap
+constexpr int ASPIRATION_DELTA = 25;
+constexpr int ASPIRATION_MAX_DELTA = 1000; // Past this, a side of the window just opens up completely
+constexpr Eval_Type FULL_WINDOW_ALPHA = MIN_EVAL - MAX_MATE_DEPTH - 1, FULL_WINDOW_BETA = MAX_EVAL + MAX_MATE_DEPTH + 1;
+
+/**
+ * The bound type of a root search result, now that the root no longer always gets searched with the full window.
+ */
+inline Bound_Type root_bound_type(Eval_Type eval, Eval_Type alpha, Eval_Type beta) {
+    if (eval >= beta) {
+        return LOWER_BOUND;
+    }
+    return eval > alpha ? EXACT : UPPER_BOUND;
+}
+
+/**
+ * Per-depth counters of how often the root search failed low or high and had to be repeated with a wider window.
+ */
+struct Aspiration_Stats {
+    uint64_t fail_lows[MAX_SEARCH_DEPTH]{};
+    uint64_t fail_highs[MAX_SEARCH_DEPTH]{};
+
+    void print(int depth) const {
+        std::cout << "info string aspiration depth " << depth << " fail lows " << fail_lows[depth] << " fail highs "
+                  << fail_highs[depth] << std::endl;
+    }
+};
+
+/**
+ * Root window around the score of the previous iteration. After a fail low or high only the failing side gets widened,
+ * by a delta that doubles with every re-search. Mate scores and shallow depths get the full window right away.
+ */
+class Aspiration_Window {
+
+public:
+    Eval_Type alpha = FULL_WINDOW_ALPHA, beta = FULL_WINDOW_BETA;
+
+    Aspiration_Window(Eval_Type previous_eval, int depth) : depth(depth) {
+        if (USE_ASPIRATION_WINDOWS && depth >= ASPIRATION_MIN_DEPTH && std::abs(previous_eval) <= MAX_EVAL) {
+            alpha = (Eval_Type) std::max(previous_eval - delta, (int) FULL_WINDOW_ALPHA);
+            beta = (Eval_Type) std::min(previous_eval + delta, (int) FULL_WINDOW_BETA);
+        }
+    }
+
+    /**
+     * @param eval The result of the root search with the current window.
+     * @return true if the search failed low or high, in which case the window got widened and the root has to be
+     * searched again.
+     */
+    bool widen(Eval_Type eval, Aspiration_Stats& stats) {
+        if (eval <= alpha && alpha > FULL_WINDOW_ALPHA) {
+            stats.fail_lows[depth]++;
+            delta *= 2;
+            alpha = delta > ASPIRATION_MAX_DELTA ? FULL_WINDOW_ALPHA
+                                                 : (Eval_Type) std::max(eval - delta, (int) FULL_WINDOW_ALPHA);
+            return true;
+        }
+        if (eval >= beta && beta < FULL_WINDOW_BETA) {
+            stats.fail_highs[depth]++;
+            delta *= 2;
+            beta = delta > ASPIRATION_MAX_DELTA ? FULL_WINDOW_BETA
+                                                : (Eval_Type) std::min(eval + delta, (int) FULL_WINDOW_BETA);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    int depth;
+    int delta = ASPIRATION_DELTA;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <bit>
+#include "chess.hpp"
+
+/**
+ * Knight, king and pawn attacks by square, and the rays of the sliders, which get cut off at the first blocker. The
+ * SEE, the TT move check and the perft move counter all use these; none of them is hot enough to be worth magic
+ * bitboards.
+ */
+class Attack_Tables {
+
+public:
+    Attack_Tables() {
+        for (int square = 0; square < 64; square++) {
+            knight_attacks[square] = steps(square, KNIGHT_STEPS);
+            king_attacks[square] = steps(square, KING_STEPS);
+            pawn_attacks[White][square] = steps(square, WHITE_PAWN_STEPS);
+            pawn_attacks[Black][square] = steps(square, BLACK_PAWN_STEPS);
+            for (int direction = 0; direction < 8; direction++) {
+                const auto& [file_step, rank_step] = RAY_STEPS[direction];
+                int file = square % 8 + file_step, rank = square / 8 + rank_step;
+                while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                    ray_squares[direction][square] |= 1ULL << (rank * 8 + file);
+                    file += file_step;
+                    rank += rank_step;
+                }
+            }
+        }
+        for (int from = 0; from < 64; from++) {
+            for (int direction = 0; direction < 8; direction++) {
+                uint64_t full_line = ray_squares[direction][from] | ray_squares[opposite(direction)][from]
+                                     | (1ULL << from);
+                for (uint64_t squares = ray_squares[direction][from]; squares; squares &= squares - 1) {
+                    int to = std::countr_zero(squares);
+                    between_squares[from][to] = ray_squares[direction][from] & ray_squares[opposite(direction)][to];
+                    line_squares[from][to] = full_line;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] inline uint64_t knight(int square) const {
+        return knight_attacks[square];
+    }
+
+    [[nodiscard]] inline uint64_t king(int square) const {
+        return king_attacks[square];
+    }
+
+    /**
+     * @param color Of the attacking pawn.
+     */
+    [[nodiscard]] inline uint64_t pawn(int color, int square) const {
+        return pawn_attacks[color][square];
+    }
+
+    [[nodiscard]] inline uint64_t bishop(int square, uint64_t occupied) const {
+        return ray(North_East, square, occupied) | ray(North_West, square, occupied)
+               | ray(South_East, square, occupied) | ray(South_West, square, occupied);
+    }
+
+    [[nodiscard]] inline uint64_t rook(int square, uint64_t occupied) const {
+        return ray(North, square, occupied) | ray(South, square, occupied)
+               | ray(East, square, occupied) | ray(West, square, occupied);
+    }
+
+    /**
+     * The squares strictly between the two, empty if they don't share a line.
+     */
+    [[nodiscard]] inline uint64_t between(int from, int to) const {
+        return between_squares[from][to];
+    }
+
+    /**
+     * The whole line through both squares, edge to edge, empty if they don't share one.
+     */
+    [[nodiscard]] inline uint64_t line(int from, int to) const {
+        return line_squares[from][to];
+    }
+
+private:
+    enum Direction { North, South, East, West, North_East, South_West, North_West, South_East }; // Opposites in pairs
+
+    static constexpr int KNIGHT_STEPS[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+    static constexpr int KING_STEPS[8][2] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1} };
+    static constexpr int WHITE_PAWN_STEPS[2][2] = { {-1, 1}, {1, 1} };
+    static constexpr int BLACK_PAWN_STEPS[2][2] = { {-1, -1}, {1, -1} };
+    static constexpr int RAY_STEPS[8][2] = { {0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {-1, -1}, {-1, 1}, {1, -1} };
+
+    static constexpr int opposite(int direction) {
+        return direction ^ 1;
+    }
+
+    /**
+     * Towards the higher squares, i.e. the nearest blocker is the lowest set bit.
+     */
+    static constexpr bool increasing(int direction) {
+        return direction == North || direction == East || direction == North_East || direction == North_West;
+    }
+
+    template<int N>
+    static uint64_t steps(int square, const int (&directions)[N][2]) {
+        uint64_t attacks = 0;
+        for (const auto& [file_step, rank_step] : directions) {
+            int file = square % 8 + file_step, rank = square / 8 + rank_step;
+            if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                attacks |= 1ULL << (rank * 8 + file);
+            }
+        }
+        return attacks;
+    }
+
+    /**
+     * The blocker itself is attacked, everything behind it is not.
+     */
+    [[nodiscard]] inline uint64_t ray(Direction direction, int square, uint64_t occupied) const {
+        uint64_t attacks = ray_squares[direction][square];
+        uint64_t blockers = attacks & occupied;
+        if (blockers) {
+            int blocker = increasing(direction) ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers);
+            attacks ^= ray_squares[direction][blocker];
+        }
+        return attacks;
+    }
+
+    uint64_t knight_attacks[64]{};
+    uint64_t king_attacks[64]{};
+    uint64_t pawn_attacks[2][64]{};
+    uint64_t ray_squares[8][64]{}; // Without the square itself
+    uint64_t between_squares[64][64]{};
+    uint64_t line_squares[64][64]{};
+};
+
+inline const Attack_Tables attack_tables;
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+#include "chess.hpp"
+#include "sequential_search.h"
+#include "simple_concurrent_search.h"
+#include "abdada_search.h"
+#include "simplified_abdada.h"
+#include "parallel_aspiration.h"
+
+constexpr int BENCH_DEPTH = 5;
+
+enum class Bench_Engine {
+    Search, Lazy_SMP, ABDADA, Simplified_ABDADA, Parallel_Aspiration, MTDF, Parallel_MTDF
+};
+
+inline std::optional<Bench_Engine> parse_bench_engine(const std::string& name) {
+    if (name == "search") {
+        return Bench_Engine::Search;
+    } else if (name == "lazysmp") {
+        return Bench_Engine::Lazy_SMP;
+    } else if (name == "abdada") {
+        return Bench_Engine::ABDADA;
+    } else if (name == "simplifiedabdada") {
+        return Bench_Engine::Simplified_ABDADA;
+    } else if (name == "parallelaspiration") {
+        return Bench_Engine::Parallel_Aspiration;
+    } else if (name == "mtdf") {
+        return Bench_Engine::MTDF;
+    } else if (name == "parallelmtdf") {
+        return Bench_Engine::Parallel_MTDF;
+    }
+    return std::nullopt;
+}
+
+/**
+ * Openings, middlegames with both kings castled and not, and endgames, so that all parts of the search get some work.
+ */
+inline const std::vector<std::string> BENCH_POSITIONS = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "rnbqkb1r/pp3ppp/4pn2/2pp4/2PP4/2N1PN2/PP3PPP/R1BQKB1R b KQkq - 0 5",
+        "r1bq1rk1/ppp1bppp/2n2n2/3pp3/4P3/2PP1N2/PP1NBPPP/R1BQ1RK1 w - - 0 8",
+        "r2q1rk1/1b2bppp/p2ppn2/1p6/3NP3/1BN1B3/PPP2PPP/R2Q1RK1 w - - 0 12",
+        "2r2rk1/pp1bqppp/2n1pn2/3p4/3P4/2PBPN2/P1Q2PPP/R1B2RK1 b - - 3 14",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+        "4r1k1/pp3ppp/2p5/8/3P4/2P2N2/PP3PPP/4R1K1 w - - 0 20",
+};
+
+/**
+ * Searches the bench positions to a fixed depth with the starting seed and an empty table for every position, to get a
+ * total node count that only changes when the search does, and the nps that goes with it. With more than one thread
+ * the node count depends on the timing of the threads, so only single threaded counts work as a signature.
+ * The drivers don't print anything per iteration here, so the output of two builds can be compared line by line.
+ * The MTD(f) engines also report how many null window probes each depth took, summed over the positions.
+ */
+template<bool Q_SEARCH, TT_Strategy strategy>
+class Bench {
+
+    Bench_Engine engine;
+    size_t num_threads;
+    uint64_t table_size_in_mb;
+    MTDF_Stats mtdf_stats; // Of all positions since the last run
+
+    [[nodiscard]] bool is_mtdf() const {
+        return engine == Bench_Engine::MTDF || engine == Bench_Engine::Parallel_MTDF;
+    }
+
+public:
+    Bench(Bench_Engine engine, size_t num_threads, uint64_t table_size_in_mb)
+            : engine(engine), num_threads(engine == Bench_Engine::Search || engine == Bench_Engine::MTDF ? 1 : std::max<size_t>(num_threads, 1)),
+              table_size_in_mb(table_size_in_mb) {
+    }
+
+    /**
+     * Iterative deepening up to depth with a fresh table. Times the search only, not setting up the table and the
+     * searchers.
+     * @return The nodes of all iterations.
+     */
+    template<class Search_Result>
+    uint64_t search_position(Board& board, int depth, double& duration) {
+        auto timed = [&](auto&& search) {
+            auto start = std::chrono::high_resolution_clock::now();
+            uint64_t nodes = search();
+            auto end = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration<double>(end - start).count();
+            return nodes;
+        };
+        if (engine == Bench_Engine::Search) {
+            Transposition_Table<strategy> table(table_size_in_mb);
+            Search<Q_SEARCH, strategy> search(board, table);
+            return timed([&] {
+                Search_Result result;
+                uint64_t nodes = 0;
+                for (int current_depth = 1; current_depth <= depth; current_depth++) {
+                    search.template aspiration_root_max<Search_Result, true>(result.eval, current_depth, result);
+                    nodes += result.nodes;
+                }
+                return nodes;
+            });
+        } else if (engine == Bench_Engine::MTDF) {
+            Transposition_Table<strategy> table(table_size_in_mb);
+            Search<Q_SEARCH, strategy> search(board, table);
+            uint64_t total_nodes = timed([&] {
+                Search_Result result;
+                uint64_t nodes = 0;
+                for (int current_depth = 1; current_depth <= depth; current_depth++) {
+                    search.template mtdf<Search_Result>(result.eval, current_depth, result);
+                    nodes += result.nodes;
+                }
+                return nodes;
+            });
+            mtdf_stats.add(search.get_mtdf_stats());
+            return total_nodes;
+        } else if (engine == Bench_Engine::ABDADA) {
+            ABDADA_TT<strategy> table(table_size_in_mb);
+            ABDADA_Search<Q_SEARCH, strategy> search(num_threads, board, table);
+            return timed([&] {
+                search.template parallel_search<Search_Result, true, false>(depth);
+                return search.get_total_nodes();
+            });
+        }
+        Locking_TT<strategy> table(table_size_in_mb);
+        if (engine == Bench_Engine::Lazy_SMP) {
+            Lazy_SMP<Q_SEARCH, strategy> search(num_threads, board, table);
+            return timed([&] {
+                search.template parallel_search<Search_Result, true, false>(depth);
+                return search.get_total_nodes();
+            });
+        } else if (engine == Bench_Engine::Parallel_MTDF) {
+            Parallel_MTDF_Search<Q_SEARCH, strategy> search(num_threads, board, table);
+            uint64_t total_nodes = timed([&] {
+                search.template parallel_search<Search_Result, false>(depth);
+                return search.get_total_nodes();
+            });
+            mtdf_stats.add(search.get_mtdf_stats());
+            return total_nodes;
+        } else if (engine == Bench_Engine::Parallel_Aspiration) {
+            Parallel_Aspiration_Search<Q_SEARCH, strategy> search(num_threads, PARALLEL_ASPIRATION_GROUPS, board, table);
+            return timed([&] {
+                search.template parallel_search<Search_Result, true, false>(depth);
+                return search.get_total_nodes();
+            });
+        }
+        Simplified_ABDADA_Search<Q_SEARCH, strategy> search(num_threads, board, table);
+        return timed([&] {
+            search.template parallel_search<Search_Result, true, false>(depth);
+            return search.get_total_nodes();
+        });
+    }
+
+    /**
+     * Restores the seed afterwards.
+     * @return The total node count.
+     */
+    template<class Search_Result>
+    uint64_t run(int depth = BENCH_DEPTH) {
+        uint64_t previous_seed = seed;
+        mtdf_stats = MTDF_Stats{};
+        uint64_t total_nodes = 0;
+        double total_time = 0;
+        std::vector<uint64_t> position_nodes;
+        for (const auto& fen : BENCH_POSITIONS) {
+            seed = STARTING_SEED;
+            Board board;
+            board.applyFen(fen);
+            double duration = 0;
+            uint64_t nodes = search_position<Search_Result>(board, depth, duration);
+            position_nodes.push_back(nodes);
+            total_nodes += nodes;
+            total_time += duration;
+        }
+        seed = previous_seed;
+
+        for (size_t i = 0; i < BENCH_POSITIONS.size(); i++) {
+            std::cout << "Position " << i + 1 << ": " << position_nodes[i] << " nodes " << BENCH_POSITIONS[i]
+                      << std::endl;
+        }
+        std::cout << "===========================" << std::endl;
+        std::cout << "Depth " << depth << ", threads " << num_threads << ", hash " << table_size_in_mb << " MB" << std::endl;
+        std::cout << "Total time (ms) : " << (uint64_t) (total_time * 1000) << std::endl;
+        std::cout << "Nodes searched  : " << total_nodes << std::endl;
+        std::cout << "Nodes/second    : " << (uint64_t) (total_nodes / total_time) << std::endl;
+        if (is_mtdf()) {
+            for (int current_depth = 1; current_depth <= depth; current_depth++) {
+                mtdf_stats.print(current_depth);
+            }
+        }
+        if (num_threads > 1) {
+            std::cout << "info string the node count with more than one thread is not deterministic" << std::endl;
+        }
+        return total_nodes;
+    }
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "perft.h"
+
+constexpr double PERFT_HEARTBEAT_SECONDS = 1; // How often a worker shows it is still working on a unit
+constexpr double PERFT_POLL_SECONDS = 0.1;
+
+/**
+ * Perft spread over worker processes through a spool directory, which can be shared by any number of local workers,
+ * e.g. started with `echo "perft worker <spool> <threads> <hash mb>" | ./random_eval_bot &`. A unit is a file with the
+ * FEN of a position split_depth plies below the root and the remaining depth, and moves through the directories
+ *   pending/<unit> -> claimed/<unit>.<worker pid> -> done/<unit>
+ * where every move is a rename, so exactly one worker gets a unit. A worker keeps touching the claimed files of the
+ * units it is working on; the coordinator moves claims that haven't been touched for lease_seconds back to pending, so
+ * the units of a worker that died get done by another one. If the first worker was only slow, both write the same
+ * count, which doesn't hurt.
+ */
+class Perft_Coordinator {
+
+    std::filesystem::path spool;
+
+    static void collect_units(Board& board, int depth, std::vector<std::string>& units) {
+        if (depth == 0) {
+            units.push_back(board.getFen());
+            return;
+        }
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (int i = 0; i < moves.size; i++) {
+            Move move = moves[i].move;
+            board.makeMove(move);
+            collect_units(board, depth - 1, units);
+            board.unmakeMove(move);
+        }
+    }
+
+    /**
+     * Moves the claims whose worker hasn't shown a sign of life in lease_seconds back to pending.
+     */
+    void reassign_lost_units(double lease_seconds) {
+        std::error_code error;
+        auto now = std::filesystem::file_time_type::clock::now();
+        for (const auto& claim : std::filesystem::directory_iterator(spool / "claimed", error)) {
+            auto last_heartbeat = std::filesystem::last_write_time(claim.path(), error);
+            if (error || std::chrono::duration<double>(now - last_heartbeat).count() < lease_seconds) {
+                continue;
+            }
+            std::string unit = claim.path().stem().string(); // Without the worker pid
+            std::filesystem::rename(claim.path(), spool / "pending" / unit, error);
+            if (!error) {
+                std::cout << "info string perft unit " << unit << " reassigned, its worker "
+                          << claim.path().extension().string().substr(1) << " is gone" << std::endl;
+            }
+        }
+    }
+
+public:
+    explicit Perft_Coordinator(std::filesystem::path spool) : spool(std::move(spool)) {
+    }
+
+    /**
+     * Hands out the units and waits for all of them to be done. Anything from an earlier run in the spool directory
+     * gets removed first.
+     */
+    uint64_t perft(Board& board, int depth, int split_depth = 2, double lease_seconds = 10) {
+        split_depth = std::clamp(split_depth, 0, std::max(depth - 1, 0));
+        std::error_code error;
+        for (const char* directory : { "pending", "claimed", "done" }) {
+            std::filesystem::remove_all(spool / directory, error);
+            std::filesystem::create_directories(spool / directory);
+        }
+        std::filesystem::remove(spool / "finished", error);
+
+        std::vector<std::string> units;
+        collect_units(board, split_depth, units);
+        for (size_t i = 0; i < units.size(); i++) { // Written under a temporary name so no worker sees a partial unit
+            std::string name = std::to_string(i);
+            std::ofstream(spool / (name + ".tmp")) << units[i] << "\n" << depth - split_depth << "\n";
+            std::filesystem::rename(spool / (name + ".tmp"), spool / "pending" / name);
+        }
+        std::cout << "info string perft depth " << depth << " split into " << units.size() << " units in " << spool
+                  << std::endl;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<uint64_t> counts(units.size(), UINT64_MAX);
+        size_t done_units = 0;
+        while (done_units < units.size()) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(PERFT_POLL_SECONDS));
+            for (const auto& result : std::filesystem::directory_iterator(spool / "done", error)) {
+                if (result.path().extension() == ".tmp") {
+                    continue;
+                }
+                size_t unit = std::stoull(result.path().filename().string());
+                uint64_t nodes;
+                std::ifstream(result.path()) >> nodes;
+                std::filesystem::remove(result.path(), error); // A second count of the unit would show up again
+                if (counts[unit] == UINT64_MAX) {
+                    counts[unit] = nodes;
+                    done_units++;
+                } else if (counts[unit] != nodes) {
+                    std::cout << "info string perft unit " << unit << " has two different counts " << counts[unit]
+                              << " and " << nodes << ": " << units[unit] << std::endl;
+                }
+            }
+            reassign_lost_units(lease_seconds);
+        }
+        std::ofstream(spool / "finished") << "\n"; // Tells the workers to stop
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+
+        uint64_t total_nodes = 0;
+        for (uint64_t nodes : counts) {
+            total_nodes += nodes;
+        }
+        std::cout << "info string perft depth " << depth << " nodes " << total_nodes << " time " << duration.count()
+                  << " nps " << (uint64_t) (total_nodes / duration.count()) << std::endl;
+        if (board.getFen() == Board(DEFAULT_POS).getFen() && depth < (int) std::size(START_POS_PERFT_RESULTS)
+                && total_nodes != START_POS_PERFT_RESULTS[depth]) {
+            std::cout << "Wrong node count at depth " << depth << ": " << total_nodes << " instead of "
+                      << START_POS_PERFT_RESULTS[depth] << std::endl;
+        }
+        return total_nodes;
+    }
+};
+
+/**
+ * The worker side of Perft_Coordinator. All threads of a worker share its perft table, and it keeps going until the
+ * coordinator says the perft is finished.
+ */
+class Perft_Worker {
+
+    std::filesystem::path spool;
+    Perft_TT table;
+    std::atomic<bool> finished = false;
+
+    /**
+     * @return The claim file, or an empty path if no unit is pending.
+     */
+    std::filesystem::path claim_unit() {
+        std::error_code error;
+        for (const auto& pending : std::filesystem::directory_iterator(spool / "pending", error)) {
+            auto claim = spool / "claimed" / (pending.path().filename().string() + "." + std::to_string(getpid()));
+            std::filesystem::rename(pending.path(), claim, error);
+            if (!error) { // A rename keeps the time of the pending file, which may well look like a lost claim already
+                std::filesystem::last_write_time(claim, std::filesystem::file_time_type::clock::now(), error);
+                return claim;
+            }
+        }
+        return {};
+    }
+
+    void work() {
+        PerftTest<Perft_TT> perft_test(table);
+        while (!finished) {
+            auto claim = claim_unit();
+            if (claim.empty()) {
+                finished = std::filesystem::exists(spool / "finished");
+                std::this_thread::sleep_for(std::chrono::duration<double>(PERFT_POLL_SECONDS));
+                continue;
+            }
+            std::string fen;
+            int depth = 0;
+            {
+                std::ifstream unit(claim);
+                std::getline(unit, fen);
+                unit >> depth;
+            }
+            Board board(fen);
+            uint64_t nodes = perft_test.hash_perft(board, depth);
+
+            std::string unit = claim.stem().string();
+            auto result = spool / "done" / (unit + "." + std::to_string(getpid()) + ".tmp");
+            std::ofstream(result) << nodes << "\n";
+            std::error_code error;
+            std::filesystem::rename(result, spool / "done" / unit, error);
+            std::filesystem::remove(claim, error);
+        }
+    }
+
+    /**
+     * Touches the claims of this worker, so that the coordinator knows we are still at them. If a claim is gone because
+     * we were too slow, the unit just gets finished anyway.
+     */
+    void heartbeat() {
+        std::string own_claims = "." + std::to_string(getpid());
+        while (!finished) {
+            std::error_code error;
+            auto now = std::filesystem::file_time_type::clock::now();
+            for (const auto& claim : std::filesystem::directory_iterator(spool / "claimed", error)) {
+                if (claim.path().extension() == own_claims) {
+                    std::filesystem::last_write_time(claim.path(), now, error);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(PERFT_HEARTBEAT_SECONDS));
+        }
+    }
+
+public:
+    Perft_Worker(std::filesystem::path spool, uint64_t table_size_in_mb)
+            : spool(std::move(spool)), table(table_size_in_mb) {
+    }
+
+    void run(size_t num_threads) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < std::max<size_t>(num_threads, 1); i++) {
+            threads.emplace_back(&Perft_Worker::work, this);
+        }
+        std::thread heartbeat_thread(&Perft_Worker::heartbeat, this);
+        heartbeat_thread.join();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::cout << "info string perft worker " << getpid() << " done" << std::endl;
+    }
+};
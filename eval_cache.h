@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+
+/**
+ * Only evaluations that are more expensive than a cache miss are worth caching. Incremental_PST and the accumulator
+ * are a handful of instructions, Pseudo_random is a single murmur hash, and caching Random would change its semantics.
+ */
+constexpr bool eval_cache_enabled(Board::Eval_Mode mode) {
+    return mode == Board::Full_PST;
+}
+
+/**
+ * Direct-mapped, per-thread evaluation cache. Since every thread owns its own cache, no locking is needed.
+ * Each entry is a single 64 bit word, the upper 48 bits of the key and the 16 bit eval. The lower bits of the key are
+ * already implied by the index, so with at least 2^16 entries the full key gets verified.
+ */
+class Eval_Cache {
+
+public:
+    static constexpr bool ENABLED = !USE_ACCUMULATOR && eval_cache_enabled(Board::EVAL_MODE);
+
+    Eval_Cache() : table(ENABLED ? EVAL_CACHE_SIZE : 0) {
+    }
+
+    /**
+     * Returns true and puts the cached eval into the second parameter reference, if the position is cached.
+     */
+    [[nodiscard]] inline bool probe(uint64_t key, Eval_Type& eval) {
+        probes++;
+        uint64_t entry = table[pos(key)];
+        if ((entry & KEY_MASK) == (key & KEY_MASK)) {
+            hits++;
+            eval = (Eval_Type) (uint16_t) entry;
+            return true;
+        }
+        return false;
+    }
+
+    inline void store(uint64_t key, Eval_Type eval) {
+        table[pos(key)] = (key & KEY_MASK) | (uint16_t) eval;
+    }
+
+    [[nodiscard]] inline uint64_t pos(uint64_t key) const {
+        return key & (EVAL_CACHE_SIZE - 1);
+    }
+
+    [[nodiscard]] uint64_t hit_count() const {
+        return hits;
+    }
+
+    [[nodiscard]] uint64_t probe_count() const {
+        return probes;
+    }
+
+    void clear() {
+        hits = 0;
+        probes = 0;
+        std::fill(table.begin(), table.end(), 0);
+    }
+
+private:
+    static constexpr uint64_t EVAL_CACHE_SIZE = 1 << 16; // 512 KB per thread, i.e. it should stay mostly in L2
+    static constexpr uint64_t KEY_MASK = ~0xFFFFULL;
+
+    std::vector<uint64_t> table;
+    uint64_t hits = 0, probes = 0;
+};
+
+/**
+ * Sums up the cache counters of all search threads and prints the overall hit rate.
+ */
+template<class Searcher>
+void print_eval_cache_stats(const std::vector<Searcher>& searchers) {
+    uint64_t hits = 0, probes = 0;
+    for (const Searcher& searcher : searchers) {
+        hits += searcher.get_eval_cache().hit_count();
+        probes += searcher.get_eval_cache().probe_count();
+    }
+    std::cout << "Eval cache probes: " << probes << ", hits: " << hits << ", hit rate: "
+              << (probes == 0 ? 0.0 : (double) hits / (double) probes) << std::endl;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <bit>
+#include "chess-library/src/chess.hpp"
+#include "attack_tables.h"
+
+using namespace Chess;
+
+/**
+ * Counts the legal moves of a position without generating them, from the check and pin masks and popcounts of the
+ * attack sets; perft only needs the number of moves at the last ply. Castling and en passant depend on state besides
+ * the pieces, so positions where either could be possible, judged from the pieces alone, go to the library move
+ * generator instead. That is rare outside of the first few plies.
+ */
+template<Color us>
+inline uint64_t count_legal_moves(Board& board) {
+    constexpr uint64_t FILE_A = 0x0101010101010101ULL, FILE_H = FILE_A << 7;
+    constexpr uint64_t RANK_1 = 0xFFULL, RANK_3 = RANK_1 << 16, RANK_4 = RANK_1 << 24, RANK_5 = RANK_1 << 32,
+            RANK_6 = RANK_1 << 40, RANK_8 = RANK_1 << 56;
+    constexpr int own_index = us == White ? 0 : 6, enemy_index = 6 - own_index;
+    const Attack_Tables& tables = attack_tables;
+    const uint64_t* pieces = board.piecesBB;
+
+    uint64_t own = 0, enemy = 0;
+    for (int i = 0; i < 6; i++) {
+        own |= pieces[own_index + i];
+        enemy |= pieces[enemy_index + i];
+    }
+    uint64_t occupied = own | enemy;
+    uint64_t own_pawns = pieces[own_index], enemy_pawns = pieces[enemy_index];
+    uint64_t enemy_rooks = pieces[enemy_index + 3] | pieces[enemy_index + 4];
+    uint64_t enemy_bishops = pieces[enemy_index + 2] | pieces[enemy_index + 4];
+    int king = std::countr_zero(pieces[own_index + 5]);
+
+    constexpr int king_start = us == White ? 4 : 60;
+    uint64_t own_rooks = pieces[own_index + 3];
+    bool might_castle = king == king_start
+            && (((own_rooks >> (king_start + 3)) & 1 && !(occupied & (0x60ULL << (king_start - 4))))
+                || ((own_rooks >> (king_start - 4)) & 1 && !(occupied & (0x0EULL << (king_start - 4)))));
+    uint64_t double_pushed; // Enemy pawns which could have just made a double push
+    if constexpr (us == White) {
+        double_pushed = enemy_pawns & RANK_5 & ~(occupied >> 8) & ~(occupied >> 16);
+    } else {
+        double_pushed = enemy_pawns & RANK_4 & ~(occupied << 8) & ~(occupied << 16);
+    }
+    bool might_capture_en_passant = (((double_pushed << 1) & ~FILE_A) | ((double_pushed >> 1) & ~FILE_H)) & own_pawns;
+    if (might_castle || might_capture_en_passant) {
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        return moves.size;
+    }
+
+    uint64_t danger = 0; // Squares the king can't go to; sliders see through the king, it can't step back along a ray
+    uint64_t occupied_without_king = occupied ^ (1ULL << king);
+    if constexpr (us == White) {
+        danger |= ((enemy_pawns >> 9) & ~FILE_H) | ((enemy_pawns >> 7) & ~FILE_A);
+    } else {
+        danger |= ((enemy_pawns << 7) & ~FILE_H) | ((enemy_pawns << 9) & ~FILE_A);
+    }
+    for (uint64_t knights = pieces[enemy_index + 1]; knights; knights &= knights - 1) {
+        danger |= tables.knight(std::countr_zero(knights));
+    }
+    for (uint64_t sliders = enemy_bishops; sliders; sliders &= sliders - 1) {
+        danger |= tables.bishop(std::countr_zero(sliders), occupied_without_king);
+    }
+    for (uint64_t sliders = enemy_rooks; sliders; sliders &= sliders - 1) {
+        danger |= tables.rook(std::countr_zero(sliders), occupied_without_king);
+    }
+    danger |= tables.king(std::countr_zero(pieces[enemy_index + 5]));
+
+    uint64_t count = std::popcount(tables.king(king) & ~own & ~danger);
+    uint64_t checkers = (tables.pawn(us, king) & enemy_pawns)
+            | (tables.knight(king) & pieces[enemy_index + 1])
+            | (tables.bishop(king, occupied) & enemy_bishops)
+            | (tables.rook(king, occupied) & enemy_rooks);
+    if (std::popcount(checkers) > 1) { // Only the king can move
+        return count;
+    }
+    uint64_t targets = ~own & (checkers ? tables.between(king, std::countr_zero(checkers)) | checkers : ~0ULL);
+
+    uint64_t pinned = 0;
+    uint64_t pinners = (tables.bishop(king, enemy) & enemy_bishops)
+            | (tables.rook(king, enemy) & enemy_rooks);
+    for (; pinners; pinners &= pinners - 1) {
+        uint64_t blockers = tables.between(king, std::countr_zero(pinners)) & occupied;
+        if (std::popcount(blockers) == 1 && (blockers & own)) {
+            pinned |= blockers;
+        }
+    }
+
+    for (uint64_t knights = pieces[own_index + 1] & ~pinned; knights; knights &= knights - 1) { // Pinned knights can't move
+        count += std::popcount(tables.knight(std::countr_zero(knights)) & targets);
+    }
+    for (uint64_t sliders = pieces[own_index + 2] | pieces[own_index + 4]; sliders; sliders &= sliders - 1) {
+        int square = std::countr_zero(sliders);
+        uint64_t attacks = tables.bishop(square, occupied) & targets;
+        count += std::popcount((pinned >> square) & 1 ? attacks & tables.line(king, square) : attacks);
+    }
+    for (uint64_t sliders = own_rooks | pieces[own_index + 4]; sliders; sliders &= sliders - 1) {
+        int square = std::countr_zero(sliders);
+        uint64_t attacks = tables.rook(square, occupied) & targets;
+        count += std::popcount((pinned >> square) & 1 ? attacks & tables.line(king, square) : attacks);
+    }
+
+    auto count_pawn_moves = [&](uint64_t pawns, uint64_t allowed) {
+        uint64_t single_pushes, double_pushes, left_captures, right_captures;
+        if constexpr (us == White) {
+            single_pushes = (pawns << 8) & ~occupied;
+            double_pushes = ((single_pushes & RANK_3) << 8) & ~occupied;
+            left_captures = (pawns << 7) & ~FILE_H & enemy;
+            right_captures = (pawns << 9) & ~FILE_A & enemy;
+        } else {
+            single_pushes = (pawns >> 8) & ~occupied;
+            double_pushes = ((single_pushes & RANK_6) >> 8) & ~occupied;
+            left_captures = (pawns >> 9) & ~FILE_H & enemy;
+            right_captures = (pawns >> 7) & ~FILE_A & enemy;
+        }
+        constexpr uint64_t promotion_rank = us == White ? RANK_8 : RANK_1;
+        uint64_t pawn_count = std::popcount(double_pushes & allowed);
+        for (uint64_t moves : { single_pushes & allowed, left_captures & allowed, right_captures & allowed }) {
+            pawn_count += std::popcount(moves & ~promotion_rank) + 4 * std::popcount(moves & promotion_rank);
+        }
+        return pawn_count;
+    };
+    count += count_pawn_moves(own_pawns & ~pinned, targets);
+    for (uint64_t pinned_pawns = own_pawns & pinned; pinned_pawns; pinned_pawns &= pinned_pawns - 1) {
+        int square = std::countr_zero(pinned_pawns);
+        count += count_pawn_moves(1ULL << square, targets & tables.line(king, square));
+    }
+    return count;
+}
+
+inline uint64_t count_legal_moves(Board& board) {
+    return board.sideToMove == White ? count_legal_moves<White>(board) : count_legal_moves<Black>(board);
+}
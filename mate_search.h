@@ -0,0 +1,378 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "chess.hpp"
+#include "locking_tt.h"
+
+constexpr uint32_t PROOF_INFINITY = 1 << 30; // Sums of children saturate here, so they can never overflow
+
+/**
+ * Proof and disproof number of a position, always with respect to the attacker delivering mate, no matter whose move it
+ * is. A proof number of 0 means the mate is proven, a disproof number of 0 that there is none within the plies left.
+ */
+struct Proof_Numbers {
+    uint32_t proof = 1, disproof = 1;
+    uint32_t work = 0; // Nodes searched below this position, the replacement priority in the table
+
+    [[nodiscard]] bool solved() const {
+        return proof == 0 || disproof == 0;
+    }
+};
+
+inline uint32_t saturating_add(uint32_t a, uint32_t b) {
+    return std::min(a + b, PROOF_INFINITY);
+}
+
+/**
+ * The df-pn node table, by position and plies left, shared by all threads. It is memory bounded: when all entries of a
+ * bucket are taken, the one with the least work below it gets replaced, as it is the cheapest to find again.
+ */
+class Proof_Table {
+
+    struct Entry {
+        uint64_t key = 0;
+        Proof_Numbers numbers = {};
+        int32_t plies = -1;
+    };
+
+    static constexpr int entries_per_bucket = 2;
+
+    struct alignas(64) Bucket {
+        Entry entries[entries_per_bucket];
+        Spin_Lock spin_lock;
+    };
+
+public:
+    explicit Proof_Table(uint64_t size_in_mb = 256) :
+            size((1 << 20) * std::bit_floor(std::max<uint64_t>(size_in_mb, 1)) / sizeof(Bucket)), mask(size - 1),
+            table(size) {
+    }
+
+    /**
+     * @return The stored numbers, or the initial (1, 1) of an unexplored position if there are none.
+     */
+    [[nodiscard]] Proof_Numbers get(uint64_t key, int32_t plies) {
+        Bucket& bucket = table[pos(key, plies)];
+        std::lock_guard<Spin_Lock> guard(bucket.spin_lock);
+        for (auto& entry : bucket.entries) {
+            if (entry.key == key && entry.plies == plies) {
+                return entry.numbers;
+            }
+        }
+        return Proof_Numbers{};
+    }
+
+    void store(uint64_t key, int32_t plies, Proof_Numbers numbers) {
+        Bucket& bucket = table[pos(key, plies)];
+        std::lock_guard<Spin_Lock> guard(bucket.spin_lock);
+        Entry* replace = &bucket.entries[0];
+        for (auto& entry : bucket.entries) {
+            if (entry.key == key && entry.plies == plies) {
+                entry.numbers = numbers;
+                return;
+            }
+            if (entry.numbers.work < replace->numbers.work) {
+                replace = &entry;
+            }
+        }
+        if (replace->key != 0) {
+            replacements++;
+        }
+        writes++;
+        *replace = Entry{key, numbers, plies};
+    }
+
+    /**
+     * This method is not thread safe because there's not really a reason to make it.
+     */
+    void print_size() const {
+        uint64_t num_elements = 0, solved_entries = 0;
+        for (const Bucket& bucket : table) {
+            for (const auto& entry : bucket.entries) {
+                if (entry.key != 0) {
+                    num_elements++;
+                    if (entry.numbers.solved()) {
+                        solved_entries++;
+                    }
+                }
+            }
+        }
+        std::cout << "info string proof table elements " << num_elements << " solved " << solved_entries << " writes "
+                  << writes << " replacements " << replacements << " buckets " << table.size() << std::endl;
+    }
+
+    /**
+     * Imo doesn't make much sense locking this.
+     */
+    void clear() {
+        writes = 0;
+        replacements = 0;
+        for (Bucket& bucket : table) {
+            for (Entry& entry : bucket.entries) {
+                entry = Entry{};
+            }
+            bucket.spin_lock.unlock(); // Just in case
+        }
+    }
+
+private:
+    /*
+     * Like in the Locking_TT, the entries of a position for different plies go to neighbouring buckets.
+     */
+    [[nodiscard]] inline uint64_t pos(uint64_t key, int32_t plies) const {
+        return (key - plies) & mask;
+    }
+
+    uint64_t size;
+    uint64_t mask;
+    std::vector<Bucket> table;
+
+    std::atomic<uint64_t> writes = 0;
+    std::atomic<uint64_t> replacements = 0;
+};
+
+/**
+ * Depth-first proof-number search (df-pn) for a mate of the side to move within a number of plies. Each thread runs
+ * its own df-pn from the root over the shared table, so the threads pick up each others results; to not all walk the
+ * same path, ties between equally promising children get broken starting from a different child in every thread.
+ */
+class Mate_Search_Thread {
+
+    Board board;
+    Proof_Table& table;
+    std::atomic<bool>& finished;
+    size_t thread_index;
+    uint64_t node_count = 0;
+    Proof_Numbers root_numbers;
+
+    /**
+     * Checks for the positions whose result is known without looking at any children.
+     * @param plies Plies left for the attacker to deliver mate.
+     * @param attacker True if the attacker is to move, i.e. this is an OR node.
+     * @return true if the position is terminal, in which case numbers is set to its result.
+     */
+    bool is_terminal(Movelist& moves, int plies, bool attacker, Proof_Numbers& numbers) {
+        if (moves.size == 0) {
+            bool mated = board.in_check();
+            numbers = (!attacker && mated) ? Proof_Numbers{0, PROOF_INFINITY, 1} : Proof_Numbers{PROOF_INFINITY, 0, 1};
+            return true;
+        }
+        if (plies == 0) { // Out of plies and the defender is not mated
+            numbers = Proof_Numbers{PROOF_INFINITY, 0, 1};
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * The numbers of all children, plus the index of the most promising one and the value of the second best, which
+     * bounds how far the search of the best child may go before the second one takes over.
+     */
+    Proof_Numbers collect_children(Movelist& moves, int plies, bool attacker, std::vector<Proof_Numbers>& children,
+                                   int& best_index, uint32_t& second_best) {
+        Proof_Numbers numbers = attacker ? Proof_Numbers{PROOF_INFINITY, 0} : Proof_Numbers{0, PROOF_INFINITY};
+        uint32_t best = PROOF_INFINITY + 1;
+        second_best = PROOF_INFINITY;
+        best_index = 0;
+        for (int n = 0; n < moves.size; n++) {
+            int i = (int) ((n + thread_index) % moves.size);
+            Move move = moves[i].move;
+            board.makeMove(move);
+            children[i] = table.get(board.hashKey, plies - 1);
+            board.unmakeMove(move);
+
+            uint32_t value = attacker ? children[i].proof : children[i].disproof;
+            if (attacker) {
+                numbers.proof = std::min(numbers.proof, children[i].proof);
+                numbers.disproof = saturating_add(numbers.disproof, children[i].disproof);
+            } else {
+                numbers.proof = saturating_add(numbers.proof, children[i].proof);
+                numbers.disproof = std::min(numbers.disproof, children[i].disproof);
+            }
+            if (value < best) {
+                second_best = best;
+                best = value;
+                best_index = i;
+            } else if (value < second_best) {
+                second_best = value;
+            }
+        }
+        return numbers;
+    }
+
+    /**
+     * The multiple iterative deepening step of df-pn: expands the current position until its proof or disproof number
+     * reaches the given threshold, then stores it in the table.
+     * @param plies Plies left for the attacker to deliver mate.
+     * @param attacker True if the attacker is to move, i.e. this is an OR node.
+     * @return The numbers of the position.
+     */
+    Proof_Numbers multiple_iterative_deepening(uint32_t proof_threshold, uint32_t disproof_threshold, int plies,
+                                               bool attacker) {
+        node_count++;
+        uint64_t key = board.hashKey;
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        Proof_Numbers numbers;
+        if (is_terminal(moves, plies, attacker, numbers)) {
+            table.store(key, plies, numbers);
+            return numbers;
+        }
+
+        std::vector<Proof_Numbers> children(moves.size);
+        uint64_t nodes_before = node_count;
+        while (true) {
+            int best_index;
+            uint32_t second_best;
+            numbers = collect_children(moves, plies, attacker, children, best_index, second_best);
+            if (numbers.proof >= proof_threshold || numbers.disproof >= disproof_threshold || finished) {
+                break;
+            }
+            Proof_Numbers& best = children[best_index];
+            uint32_t child_proof_threshold, child_disproof_threshold;
+            if (attacker) {
+                child_proof_threshold = std::min(proof_threshold, saturating_add(second_best, 1));
+                child_disproof_threshold = disproof_threshold >= PROOF_INFINITY ? PROOF_INFINITY
+                        : saturating_add(disproof_threshold - numbers.disproof, best.disproof);
+            } else {
+                child_disproof_threshold = std::min(disproof_threshold, saturating_add(second_best, 1));
+                child_proof_threshold = proof_threshold >= PROOF_INFINITY ? PROOF_INFINITY
+                        : saturating_add(proof_threshold - numbers.proof, best.proof);
+            }
+            Move move = moves[best_index].move;
+            board.makeMove(move);
+            multiple_iterative_deepening(child_proof_threshold, child_disproof_threshold, plies - 1, !attacker);
+            board.unmakeMove(move);
+        }
+        numbers.work = (uint32_t) std::min<uint64_t>(node_count - nodes_before + 1, PROOF_INFINITY);
+        if (!finished || numbers.solved()) { // Aborted searches still have sound numbers, but don't overwrite others
+            table.store(key, plies, numbers);
+        }
+        return numbers;
+    }
+
+public:
+    Mate_Search_Thread(Board& board, Proof_Table& table, std::atomic<bool>& finished, size_t thread_index)
+            : board(board), table(table), finished(finished), thread_index(thread_index) {
+    }
+
+    /**
+     * Runs df-pn from the root until it is solved, or some other thread solved it.
+     */
+    void solve(int plies, std::atomic<uint64_t>& total_node_count) {
+        node_count = 0;
+        root_numbers = multiple_iterative_deepening(PROOF_INFINITY, PROOF_INFINITY, plies, true);
+        if (root_numbers.solved()) {
+            finished = true;
+        }
+        total_node_count += node_count;
+    }
+
+    [[nodiscard]] const Proof_Numbers& get_root_numbers() const {
+        return root_numbers;
+    }
+};
+
+struct Mate_Result {
+    uint64_t nodes = 0;
+    double duration = 0;
+    bool proven = false;
+    std::vector<Move> line;
+
+    void print_uci() const {
+        int millis = (int) (duration * 1000);
+        std::cout << "info depth " << line.size() << " score mate " << (line.size() + 1) / 2 << " time " << millis
+                  << " nodes " << nodes << " nps " << (nodes / (millis / 1000 + 1)) << " pv ";
+        for (Move move : line) {
+            std::cout << convertMoveToUci(move) << " ";
+        }
+        std::cout << std::endl;
+    }
+};
+
+/**
+ * Solves mate in N for the side to move with df-pn over num_threads threads and a table of the given size.
+ */
+class Mate_Search {
+
+    Board& board;
+    Proof_Table table;
+
+    /**
+     * Follows the proven children from the root. The attacker takes any proven move, the defender the one with the most
+     * work below it, i.e. the longest resistance the search saw. If an entry along the way got replaced, the line just
+     * stops there.
+     */
+    std::vector<Move> mate_line(int plies) {
+        std::vector<Move> line;
+        Board copy(board);
+        bool attacker = true;
+        while (plies > 0) {
+            Movelist moves;
+            Movegen::legalmoves<ALL>(copy, moves);
+            Move best_move = NO_MOVE;
+            uint32_t most_work = 0;
+            for (auto& ext_move : moves) {
+                copy.makeMove(ext_move.move);
+                Proof_Numbers child = table.get(copy.hashKey, plies - 1);
+                copy.unmakeMove(ext_move.move);
+                if (child.proof == 0 && (best_move == NO_MOVE || (!attacker && child.work > most_work))) {
+                    best_move = ext_move.move;
+                    most_work = child.work;
+                }
+            }
+            if (best_move == NO_MOVE) {
+                break;
+            }
+            line.push_back(best_move);
+            copy.makeMove(best_move);
+            attacker = !attacker;
+            plies--;
+        }
+        return line;
+    }
+
+public:
+    Mate_Search(Board& board, uint64_t table_size_in_mb) : board(board), table(table_size_in_mb) {
+    }
+
+    Mate_Result solve(int mate_in_moves, size_t num_threads) {
+        int plies = 2 * std::max(mate_in_moves, 1) - 1;
+        std::atomic<bool> finished = false;
+        std::atomic<uint64_t> node_count = 0;
+        std::vector<Mate_Search_Thread> searchers;
+        for (size_t i = 0; i < num_threads; i++) {
+            searchers.emplace_back(board, table, finished, i);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> search_threads;
+        for (auto& searcher : searchers) {
+            search_threads.emplace_back(&Mate_Search_Thread::solve, &searcher, plies, std::ref(node_count));
+        }
+        for (auto& thread : search_threads) {
+            thread.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+
+        Mate_Result result;
+        result.nodes = node_count;
+        result.duration = duration.count();
+        for (const auto& searcher : searchers) { // The root entry itself might have been replaced already
+            result.proven |= searcher.get_root_numbers().proof == 0;
+        }
+        if (result.proven) {
+            result.line = mate_line(plies);
+        }
+        table.print_size();
+        return result;
+    }
+};
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+#include "quiescence_search.h"
+
+constexpr double MCTS_EXPLORATION = 1.4;
+constexpr int32_t MCTS_VIRTUAL_LOSS = 3; // Counted as this many lost visits while a thread is below a node
+constexpr double MCTS_LOGISTIC_SCALE = 400; // Centipawns, for the PST evals
+constexpr int64_t MCTS_VALUE_SCALE = 1 << 16; // Values in [0, 1] get summed up as fixed point integers
+constexpr uint64_t MCTS_CLOCK_INTERVAL = 256; // Playouts between checks of the time limit
+
+/**
+ * Turns an eval of the side to move into a value in [0, 1]. The PST evals get the usual logistic curve, the random
+ * eval modes are uniform over the whole eval range, so there it is just linear.
+ */
+inline double eval_to_value(Eval_Type eval) {
+    if constexpr (material_pruning_enabled(Board::EVAL_MODE)) {
+        return 1 / (1 + std::exp(-eval / MCTS_LOGISTIC_SCALE));
+    } else {
+        return (double) (std::clamp(eval, MIN_EVAL, MAX_EVAL) - MIN_EVAL) / (MAX_EVAL - MIN_EVAL);
+    }
+}
+
+inline Eval_Type value_to_eval(double value) {
+    double eval;
+    if constexpr (material_pruning_enabled(Board::EVAL_MODE)) {
+        value = std::clamp(value, 1e-6, 1 - 1e-6);
+        eval = MCTS_LOGISTIC_SCALE * std::log(value / (1 - value));
+    } else {
+        eval = MIN_EVAL + value * (MAX_EVAL - MIN_EVAL);
+    }
+    return (Eval_Type) std::clamp<double>(eval, MIN_EVAL, MAX_EVAL);
+}
+
+enum Expansion_State : uint8_t {
+    UNEXPANDED, EXPANDING, EXPANDED
+};
+
+/**
+ * The value sum is from the point of view of the side that made the move leading here, i.e. what the parent maximizes.
+ * The children of a node are contiguous in the arena and only become visible once the state is EXPANDED.
+ */
+struct MCTS_Node {
+    std::atomic<int64_t> value_sum = 0;
+    std::atomic<uint32_t> visits = 0;
+    std::atomic<int32_t> virtual_loss = 0;
+    std::atomic<uint32_t> first_child = 0;
+    std::atomic<uint16_t> child_count = 0;
+    std::atomic<uint8_t> state = UNEXPANDED;
+    Move move = NO_MOVE;
+
+    void reset(Move new_move) {
+        value_sum.store(0, std::memory_order_relaxed);
+        visits.store(0, std::memory_order_relaxed);
+        virtual_loss.store(0, std::memory_order_relaxed);
+        first_child.store(0, std::memory_order_relaxed);
+        child_count.store(0, std::memory_order_relaxed);
+        state.store(UNEXPANDED, std::memory_order_relaxed);
+        move = new_move;
+    }
+
+    [[nodiscard]] double mean_value() const {
+        uint32_t n = visits.load(std::memory_order_relaxed);
+        return n == 0 ? 0.5 : (double) value_sum.load(std::memory_order_relaxed) / MCTS_VALUE_SCALE / n;
+    }
+};
+
+/**
+ * Pool of nodes that only ever grows during a search, so allocating the children of a node is a single fetch_add.
+ * Node 0 is the root. Once the pool is full, nodes simply stay leaves.
+ */
+class MCTS_Arena {
+
+public:
+    explicit MCTS_Arena(uint64_t size_in_mb = 256) :
+            capacity((uint32_t) std::min<uint64_t>((1 << 20) * size_in_mb / sizeof(MCTS_Node), UINT32_MAX)),
+            nodes(capacity) {
+    }
+
+    /**
+     * @return The index of the first of count contiguous nodes, or 0 if the arena is full.
+     */
+    uint32_t allocate(uint32_t count) {
+        if (used.load(std::memory_order_relaxed) + count > capacity) { // Avoids pushing used far past the end
+            return 0;
+        }
+        uint32_t first = used.fetch_add(count, std::memory_order_relaxed);
+        return first + count <= capacity ? first : 0;
+    }
+
+    inline MCTS_Node& operator[](uint32_t index) {
+        return nodes[index];
+    }
+
+    [[nodiscard]] uint32_t size() const {
+        return std::min(used.load(), capacity);
+    }
+
+    /**
+     * Not thread safe, only call this between searches.
+     */
+    void clear() {
+        nodes[0].reset(NO_MOVE);
+        used = 1;
+    }
+
+private:
+    uint32_t capacity;
+    std::vector<MCTS_Node> nodes;
+    std::atomic<uint32_t> used = 1;
+};
+
+/**
+ * One thread of tree parallel MCTS. All threads work on the same tree; a thread that is below a node adds virtual loss
+ * to it, so the other threads are steered to different parts of the tree in the meantime.
+ */
+class MCTS_Thread {
+
+    Board board;
+    MCTS_Arena& arena;
+    std::atomic<bool>& finished;
+    uint64_t playouts = 0;
+    int max_depth = 0;
+    std::vector<uint32_t> path;
+
+    /**
+     * UCT over the children, where virtual losses count as visits with value 0.
+     */
+    uint32_t select(MCTS_Node& node) {
+        uint32_t first = node.first_child.load(std::memory_order_relaxed);
+        uint16_t count = node.child_count.load(std::memory_order_relaxed);
+        double parent_visits = node.visits.load(std::memory_order_relaxed) + node.virtual_loss.load(std::memory_order_relaxed);
+        double log_parent = std::log(parent_visits + 1);
+        uint32_t best = first;
+        double best_score = -1;
+        for (uint32_t i = first; i < first + count; i++) {
+            MCTS_Node& child = arena[i];
+            double visits = child.visits.load(std::memory_order_relaxed) + child.virtual_loss.load(std::memory_order_relaxed);
+            if (visits == 0) { // Every child gets one visit before any gets a second
+                return i;
+            }
+            double score = (double) child.value_sum.load(std::memory_order_relaxed) / MCTS_VALUE_SCALE / visits
+                    + MCTS_EXPLORATION * std::sqrt(log_parent / visits);
+            if (score > best_score) {
+                best_score = score;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * Only the thread that wins the state CAS allocates and fills the children, everyone else just treats the node as
+     * a leaf for this playout instead of waiting.
+     */
+    void expand(MCTS_Node& node, Movelist& moves) {
+        uint8_t expected = UNEXPANDED;
+        if (!node.state.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire)) {
+            return;
+        }
+        uint32_t first = arena.allocate(moves.size);
+        if (first == 0) {
+            node.state.store(UNEXPANDED, std::memory_order_relaxed);
+            return;
+        }
+        for (int i = 0; i < moves.size; i++) {
+            arena[first + i].reset(moves[i].move);
+        }
+        node.first_child.store(first, std::memory_order_relaxed);
+        node.child_count.store(moves.size, std::memory_order_relaxed);
+        node.state.store(EXPANDED, std::memory_order_release);
+    }
+
+    /**
+     * @return The value of the leaf for its side to move.
+     */
+    double leaf_value(MCTS_Node& node) {
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        if (moves.size == 0) {
+            return board.in_check() ? 0 : 0.5;
+        }
+        expand(node, moves);
+        return eval_to_value(board.eval());
+    }
+
+    void playout() {
+        path.clear();
+        uint32_t index = 0;
+        while (true) {
+            MCTS_Node& node = arena[index];
+            node.virtual_loss.fetch_add(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+            path.push_back(index);
+            if (node.state.load(std::memory_order_acquire) != EXPANDED) {
+                break;
+            }
+            index = select(node);
+            board.makeMove(arena[index].move);
+        }
+        max_depth = std::max(max_depth, (int) path.size() - 1);
+
+        double value = 1 - leaf_value(arena[index]); // For the side that moved into the leaf
+        for (size_t i = path.size(); i-- > 0;) {
+            MCTS_Node& node = arena[path[i]];
+            node.value_sum.fetch_add((int64_t) (value * MCTS_VALUE_SCALE), std::memory_order_relaxed);
+            node.visits.fetch_add(1, std::memory_order_relaxed);
+            node.virtual_loss.fetch_sub(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+            if (i > 0) {
+                board.unmakeMove(node.move);
+            }
+            value = 1 - value;
+        }
+        playouts++;
+    }
+
+public:
+    MCTS_Thread(Board& board, MCTS_Arena& arena, std::atomic<bool>& finished)
+            : board(board), arena(arena), finished(finished) {
+    }
+
+    void search(double seconds, std::atomic<uint64_t>& total_playouts) {
+        playouts = 0;
+        max_depth = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        while (!finished) {
+            playout();
+            if (playouts % MCTS_CLOCK_INTERVAL == 0) {
+                std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+                if (elapsed.count() >= seconds) {
+                    finished = true;
+                }
+            }
+        }
+        total_playouts += playouts;
+    }
+
+    [[nodiscard]] int get_max_depth() const {
+        return max_depth;
+    }
+};
+
+/**
+ * Monte Carlo tree search with UCT, using the board eval of the leaves instead of random playouts. The move with the
+ * most visits gets played, and the eval of the result is its mean value mapped back onto the eval scale.
+ */
+class MCTS_Search {
+
+    size_t num_threads;
+    Board& board;
+    MCTS_Arena& arena;
+    std::atomic<bool> finished = false;
+    std::vector<MCTS_Thread> searchers;
+
+    uint32_t most_visited_child(MCTS_Node& node) {
+        uint32_t first = node.first_child, best = 0, most_visits = 0;
+        for (uint32_t i = first; i < first + node.child_count; i++) {
+            if (best == 0 || arena[i].visits > most_visits) {
+                best = i;
+                most_visits = arena[i].visits;
+            }
+        }
+        return best;
+    }
+
+    void print_pv() {
+        uint32_t index = 0;
+        while (arena[index].state == EXPANDED && arena[index].visits > 1) {
+            index = most_visited_child(arena[index]);
+            std::cout << convertMoveToUci(arena[index].move) << " ";
+        }
+        std::cout << std::endl;
+    }
+
+public:
+    MCTS_Search(size_t num_threads, Board& board, MCTS_Arena& arena)
+            : num_threads(num_threads), board(board), arena(arena) {
+        for (size_t i = 0; i < num_threads; i++) {
+            searchers.emplace_back(board, arena, finished);
+        }
+    }
+
+    /**
+     * @param seconds Time limit, so the playouts per second can be compared to the alpha-beta engines at equal time.
+     */
+    template<class Search_Result>
+    Search_Result search(double seconds) {
+        arena.clear();
+        finished = false;
+        std::atomic<uint64_t> playouts = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> search_threads;
+        for (auto& searcher : searchers) {
+            search_threads.emplace_back(&MCTS_Thread::search, &searcher, seconds, std::ref(playouts));
+        }
+        for (auto& thread : search_threads) {
+            thread.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+
+        Search_Result result;
+        result.duration = duration.count();
+        result.nodes = playouts;
+        for (const auto& searcher : searchers) {
+            result.depth = std::max<uint16_t>(result.depth, searcher.get_max_depth());
+        }
+        uint32_t best = most_visited_child(arena[0]);
+        if (best != 0) {
+            result.move = arena[best].move;
+            result.eval = value_to_eval(arena[best].mean_value());
+        }
+        result.print_uci();
+        print_pv();
+        std::cout << "info string mcts playouts " << playouts << " pps " << (uint64_t) (playouts / result.duration)
+                  << " arena nodes " << arena.size() << " threads " << num_threads << std::endl;
+        return result;
+    }
+};
@@ -0,0 +1,10 @@
+#include <string>
+#include "microbench.h"
+
+int main(int argc, char* argv[]) {
+    size_t max_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    uint64_t repetitions = argc > 2 ? std::stoull(argv[2]) : 10000;
+    Microbenchmarks microbenchmarks(max_threads, repetitions);
+    microbenchmarks.run();
+    return 0;
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chess.hpp"
+#include "transposition_table.h"
+#include "locking_tt.h"
+#include "abdada_tt.h"
+#include "simple_concurrent_search.h"
+#include "bench.h"
+
+/**
+ * Timings of the primitives the search is built from, each on its own, so that a change in the nps of the search can
+ * be traced back to the primitive that moved. The positions are the bench positions, the table keys come from murmur64
+ * with the starting seed, so every run measures the same work.
+ */
+class Microbenchmarks {
+
+    static constexpr uint64_t TABLE_SIZE_IN_MB = 64;
+    static constexpr uint64_t TABLE_OPERATIONS = 1 << 22; // Per benchmark, split over the threads
+
+    size_t max_threads;
+    uint64_t repetitions;
+    std::vector<Board> boards;
+    std::vector<uint64_t> keys;
+    volatile uint64_t sink = 0; // Keeps the compiler from throwing away the results
+
+    template<class Function>
+    void measure(const std::string& name, uint64_t operations, Function&& function) {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << operations << " ops "
+                  << std::setw(10) << std::fixed << std::setprecision(2) << duration.count() * 1e9 / (double) operations
+                  << " ns/op " << std::setw(14) << (uint64_t) ((double) operations / duration.count()) << " ops/s"
+                  << std::defaultfloat << std::endl;
+    }
+
+    /**
+     * Runs work(thread_index, begin, end) on num_threads threads, each with its share of the keys.
+     */
+    template<class Work>
+    static void on_threads(size_t num_threads, uint64_t operations, Work&& work) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < num_threads; i++) {
+            threads.emplace_back(work, i, operations * i / num_threads, operations * (i + 1) / num_threads);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    [[nodiscard]] std::vector<size_t> thread_counts() const {
+        std::vector<size_t> counts;
+        for (size_t threads = 1; threads < max_threads; threads *= 2) {
+            counts.push_back(threads);
+        }
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+    void transposition_table() {
+        Transposition_Table<REPLACE_LAST_ENTRY> table(TABLE_SIZE_IN_MB);
+        measure("Transposition_Table store", TABLE_OPERATIONS, [&] {
+            for (uint64_t i = 0; i < TABLE_OPERATIONS; i++) {
+                int8_t depth = (int8_t) (i % 16);
+                table.emplace(keys[i], TT_Info{(Eval_Type) i, NO_MOVE, depth, EXACT}, depth);
+            }
+        });
+        measure("Transposition_Table probe", TABLE_OPERATIONS, [&] {
+            TT_Info info{};
+            uint64_t hits = 0;
+            for (uint64_t i = 0; i < TABLE_OPERATIONS; i++) {
+                hits += table.get_if_exists(keys[i], (int32_t) (i % 16), info);
+            }
+            sink = sink + hits;
+        });
+    }
+
+    void locking_tt() {
+        for (size_t threads : thread_counts()) {
+            Locking_TT<REPLACE_LAST_ENTRY> table(TABLE_SIZE_IN_MB);
+            std::string suffix = " " + std::to_string(threads) + " threads";
+            measure("Locking_TT store" + suffix, TABLE_OPERATIONS, [&] {
+                on_threads(threads, TABLE_OPERATIONS, [&](size_t, uint64_t begin, uint64_t end) {
+                    for (uint64_t i = begin; i < end; i++) {
+                        int8_t depth = (int8_t) (i % 16);
+                        table.emplace(keys[i], Locked_TT_Info{(Eval_Type) i, NO_MOVE, depth, EXACT}, depth);
+                    }
+                });
+            });
+            measure("Locking_TT probe" + suffix, TABLE_OPERATIONS, [&] {
+                std::atomic<uint64_t> hits = 0;
+                on_threads(threads, TABLE_OPERATIONS, [&](size_t, uint64_t begin, uint64_t end) {
+                    Locked_TT_Info info{};
+                    uint64_t thread_hits = 0;
+                    for (uint64_t i = begin; i < end; i++) {
+                        thread_hits += table.get_if_exists(keys[i], (int32_t) (i % 16), info);
+                    }
+                    hits += thread_hits;
+                });
+                sink = sink + hits;
+            });
+        }
+    }
+
+    void abdada_tt() {
+        for (size_t threads : thread_counts()) {
+            ABDADA_TT<REPLACE_LAST_ENTRY> table(TABLE_SIZE_IN_MB);
+            std::string suffix = " " + std::to_string(threads) + " threads";
+            measure("ABDADA_TT store" + suffix, TABLE_OPERATIONS, [&] {
+                on_threads(threads, TABLE_OPERATIONS, [&](size_t, uint64_t begin, uint64_t end) {
+                    for (uint64_t i = begin; i < end; i++) {
+                        int8_t depth = (int8_t) (i % 16);
+                        table.template emplace<false>(keys[i], ABDADA_TT_Info{(Eval_Type) i, NO_MOVE, depth, EXACT, 0},
+                                                      depth);
+                    }
+                });
+            });
+            measure("ABDADA_TT probe" + suffix, TABLE_OPERATIONS, [&] {
+                std::atomic<uint64_t> hits = 0;
+                on_threads(threads, TABLE_OPERATIONS, [&](size_t, uint64_t begin, uint64_t end) {
+                    ABDADA_TT_Info info{};
+                    uint64_t thread_hits = 0;
+                    for (uint64_t i = begin; i < end; i++) {
+                        thread_hits += table.template get_if_exists<false>(keys[i], (int32_t) (i % 16), info, false);
+                    }
+                    hits += thread_hits;
+                });
+                sink = sink + hits;
+            });
+        }
+    }
+
+    template<Movetype TYPE>
+    void movegen(const std::string& name) {
+        measure(name, repetitions * boards.size(), [&] {
+            uint64_t total_moves = 0;
+            for (uint64_t r = 0; r < repetitions; r++) {
+                for (Board& board : boards) {
+                    Movelist moves;
+                    Movegen::legalmoves<TYPE>(board, moves);
+                    total_moves += moves.size;
+                }
+            }
+            sink = sink + total_moves;
+        });
+    }
+
+    /**
+     * The move lists get generated up front, so only making and unmaking the moves is timed.
+     */
+    void make_unmake() {
+        std::vector<Movelist> move_lists(boards.size());
+        uint64_t moves_per_repetition = 0;
+        for (size_t i = 0; i < boards.size(); i++) {
+            Movegen::legalmoves<ALL>(boards[i], move_lists[i]);
+            moves_per_repetition += move_lists[i].size;
+        }
+        measure("makeMove + unmakeMove", repetitions * moves_per_repetition, [&] {
+            for (uint64_t r = 0; r < repetitions; r++) {
+                for (size_t i = 0; i < boards.size(); i++) {
+                    for (auto& move_container : move_lists[i]) {
+                        boards[i].makeMove(move_container.move);
+                        boards[i].unmakeMove(move_container.move);
+                    }
+                }
+            }
+        });
+    }
+
+    template<Board::Eval_Mode mode>
+    void eval(const std::string& name) {
+        measure(name, 100 * repetitions * boards.size(), [&] {
+            int64_t total = 0;
+            for (uint64_t r = 0; r < 100 * repetitions; r++) {
+                for (Board& board : boards) {
+                    total += board.eval<mode>();
+                }
+            }
+            sink = sink + (uint64_t) total;
+        });
+    }
+
+    void shuffled_moves() {
+        Locking_TT<REPLACE_LAST_ENTRY> table(1);
+        std::atomic<bool> finished = false;
+        std::vector<Search_Thread<false, REPLACE_LAST_ENTRY>> searchers;
+        for (Board& board : boards) {
+            searchers.emplace_back(board, table, finished);
+        }
+        measure("generate_shuffled_moves<ALL>", repetitions * boards.size(), [&] {
+            uint64_t total_moves = 0;
+            for (uint64_t r = 0; r < repetitions; r++) {
+                for (auto& searcher : searchers) {
+                    Movelist moves;
+                    searcher.template generate_shuffled_moves<ALL>(moves);
+                    total_moves += moves.size;
+                }
+            }
+            sink = sink + total_moves;
+        });
+    }
+
+public:
+    explicit Microbenchmarks(size_t max_threads, uint64_t repetitions = 10000)
+            : max_threads(std::max<size_t>(max_threads, 1)), repetitions(std::max<uint64_t>(repetitions, 1)) {
+        for (const auto& fen : BENCH_POSITIONS) {
+            Board board;
+            board.applyFen(fen);
+            boards.push_back(board);
+        }
+        uint64_t previous_seed = seed;
+        seed = STARTING_SEED;
+        for (uint64_t i = 0; i < TABLE_OPERATIONS; i++) {
+            keys.push_back(murmur64(i + 1));
+        }
+        seed = previous_seed;
+    }
+
+    void run() {
+        transposition_table();
+        locking_tt();
+        abdada_tt();
+        movegen<ALL>("legalmoves<ALL>");
+        movegen<CAPTURE>("legalmoves<CAPTURE>");
+        make_unmake();
+        eval<Board::Full_PST>("eval<Full_PST>");
+        if constexpr (Board::EVAL_MODE == Board::Incremental_PST) { // Only then are the incremental values kept up to date
+            eval<Board::Incremental_PST>("eval<Incremental_PST>");
+        }
+        eval<Board::Random>("eval<Random>");
+        eval<Board::Pseudo_random>("eval<Pseudo_random>");
+        shuffled_moves();
+    }
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+
+/**
+ * Per-thread killer, history and countermove tables. These only order the moves after the TT move, the rest of the
+ * order stays the random shuffle, i.e. moves of equal score keep their shuffled order.
+ * The order is: captures, the two killers, the countermove, then all other quiet moves by history score.
+ * A move counts as quiet if its target square is empty, which for the purpose of move ordering is close enough.
+ */
+class Move_Ordering {
+
+public:
+    static constexpr int32_t CAPTURE_SCORE = 1 << 30;
+    static constexpr int32_t KILLER_SCORE = 1 << 29;
+    static constexpr int32_t COUNTER_MOVE_SCORE = 1 << 28;
+    static constexpr int32_t MAX_HISTORY = 1 << 14;
+
+    /**
+     * Remembers the move and the moved piece for the countermove heuristic. Has to be called before the move is made.
+     */
+    inline void push(Board& board, Move move) {
+        assert(ply + 1 < MAX_PLY);
+        ply++;
+        previous[ply] = {move, move == NO_MOVE ? None : board.board[from(move)]};
+    }
+
+    inline void pop() {
+        ply--;
+    }
+
+    /**
+     * Assigns every move of the list its score, the move picker then hands them out from highest to lowest.
+     */
+    void score(Board& board, Movelist& moves) const {
+        const Move* killer = killers[ply];
+        Move counter_move = counter_move_to(previous[ply]);
+        for (auto& move : moves) {
+            if (board.board[to(move.move)] != None) {
+                move.value = CAPTURE_SCORE;
+            } else if (move.move == killer[0]) {
+                move.value = KILLER_SCORE + 1;
+            } else if (move.move == killer[1]) {
+                move.value = KILLER_SCORE;
+            } else if (move.move == counter_move) {
+                move.value = COUNTER_MOVE_SCORE;
+            } else {
+                move.value = history[board.board[from(move.move)]][to(move.move)];
+            }
+        }
+    }
+
+    /**
+     * Should be called when the move produced a beta cutoff, with the move already unmade again.
+     */
+    void update(Board& board, Move move, int depth) {
+        if (board.board[to(move)] != None) { // Only quiet moves go into the tables
+            return;
+        }
+        Move* killer = killers[ply];
+        if (killer[0] != move) {
+            killer[1] = killer[0];
+            killer[0] = move;
+        }
+
+        const Previous_Move& previous_move = previous[ply];
+        if (previous_move.move != NO_MOVE) {
+            counter_moves[previous_move.piece][to(previous_move.move)] = move;
+        }
+
+        int32_t& entry = history[board.board[from(move)]][to(move)];
+        int32_t bonus = depth * depth;
+        entry += bonus - entry * bonus / MAX_HISTORY; // Gravity, keeps the entries below MAX_HISTORY without any aging
+    }
+
+private:
+    struct Previous_Move {
+        Move move = NO_MOVE;
+        Piece piece = None;
+    };
+
+    inline Move counter_move_to(const Previous_Move& previous_move) const {
+        if (previous_move.move == NO_MOVE) {
+            return NO_MOVE;
+        }
+        return counter_moves[previous_move.piece][to(previous_move.move)];
+    }
+
+    int ply = 0;
+    Previous_Move previous[MAX_PLY]{};
+    Move killers[MAX_PLY][2]{};
+    Move counter_moves[12][64]{};
+    int32_t history[12][64]{};
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <bit>
+#include "chess.hpp"
+#include "attack_tables.h"
+
+/**
+ * Hands out the TT move before any move generation happens. Only if the TT move did not produce a cutoff, i.e. the
+ * search asks for another move, the remaining moves get generated (and shuffled by the generator) and returned in
+ * that order, skipping the TT move. Most of the tree are null window nodes that usually cut on the first move, so
+ * there this saves the move generation and the shuffle entirely.
+ */
+class Staged_Move_Picker {
+
+private:
+    enum Stage {
+        TT_MOVE, GENERATE, REMAINING
+    };
+
+    Move tt_move;
+    Stage stage = TT_MOVE;
+    Movelist moves;
+    int index = 0;
+
+    static bool in_legal_moves(Board& board, Move move) {
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (int i = 0; i < moves.size; i++) {
+            if (moves[i].move == move) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * The TT entries are verified against the full 64 bit hash key, but a full key collision can still hand us a move
+     * of another position, and the searchers make the TT move without any further check. So the move has to be pseudo
+     * legal here, including the path of a slider and the geometry of a pawn move, and must not leave our king in check.
+     * Castling, en passant and anything that could be a promotion depend on more than the pieces and on how the move is
+     * encoded; those are rare enough to just look them up in the legal move list.
+     */
+    static bool is_legal(Board& board, Move move) {
+        if (move == NO_MOVE) {
+            return false;
+        }
+        const Color us = board.sideToMove;
+        const int own_index = us == White ? 0 : 6, enemy_index = 6 - own_index;
+        const int from_square = from(move), to_square = to(move);
+        const uint64_t from_bit = 1ULL << from_square, to_bit = 1ULL << to_square;
+        Piece moving = board.board[from_square];
+        if (moving == None || (moving < BlackPawn) != (us == White)) {
+            return false;
+        }
+        int from_rank = from_square / 8, to_rank = to_square / 8;
+        if ((to_rank == 7 && from_rank == 6) || (to_rank == 0 && from_rank == 1)) { // Might carry a promotion piece
+            return in_legal_moves(board, move);
+        }
+
+        uint64_t own = 0, enemy = 0;
+        for (int i = 0; i < 6; i++) {
+            own |= board.piecesBB[own_index + i];
+            enemy |= board.piecesBB[enemy_index + i];
+        }
+        uint64_t occupied = own | enemy;
+        int type = moving - own_index;
+        if (type == 5 && (!(attack_tables.king(from_square) & to_bit) || (own & to_bit))) { // Castling
+            return in_legal_moves(board, move);
+        }
+        if (own & to_bit) {
+            return false;
+        }
+
+        uint64_t reachable;
+        switch (type) {
+            case 0: {
+                int forward = us == White ? 8 : -8;
+                if (attack_tables.pawn(us, from_square) & to_bit) {
+                    if (!(enemy & to_bit)) { // En passant
+                        return in_legal_moves(board, move);
+                    }
+                    reachable = to_bit;
+                } else if (to_square == from_square + forward) {
+                    reachable = to_bit & ~occupied;
+                } else if (to_square == from_square + 2 * forward && from_rank == (us == White ? 1 : 6)) {
+                    reachable = (occupied >> (from_square + forward)) & 1 ? 0 : to_bit & ~occupied;
+                } else {
+                    reachable = 0;
+                }
+                break;
+            }
+            case 1: reachable = attack_tables.knight(from_square); break;
+            case 2: reachable = attack_tables.bishop(from_square, occupied); break;
+            case 3: reachable = attack_tables.rook(from_square, occupied); break;
+            case 4:
+                reachable = attack_tables.bishop(from_square, occupied) | attack_tables.rook(from_square, occupied);
+                break;
+            default: reachable = attack_tables.king(from_square); break;
+        }
+        if (!(reachable & to_bit)) {
+            return false;
+        }
+
+        // Is our king attacked after the move? A captured piece doesn't attack any more.
+        uint64_t occupied_after = (occupied & ~from_bit) | to_bit;
+        uint64_t remaining_enemy = ~to_bit;
+        int king = type == 5 ? to_square : std::countr_zero(board.piecesBB[own_index + 5]);
+        const uint64_t* pieces = board.piecesBB;
+        uint64_t enemy_bishops = (pieces[enemy_index + 2] | pieces[enemy_index + 4]) & remaining_enemy;
+        uint64_t enemy_rooks = (pieces[enemy_index + 3] | pieces[enemy_index + 4]) & remaining_enemy;
+        return !((attack_tables.pawn(us, king) & pieces[enemy_index] & remaining_enemy)
+                 || (attack_tables.knight(king) & pieces[enemy_index + 1] & remaining_enemy)
+                 || (attack_tables.bishop(king, occupied_after) & enemy_bishops)
+                 || (attack_tables.rook(king, occupied_after) & enemy_rooks)
+                 || (attack_tables.king(king) & pieces[enemy_index + 5]));
+    }
+
+public:
+    Staged_Move_Picker(Board& board, Move tt_move) : tt_move(is_legal(board, tt_move) ? tt_move : NO_MOVE) {
+    }
+
+    /**
+     * @tparam ORDERED If true, the generator is expected to also score the moves, and the remaining moves are handed out
+     * by descending score. Ties keep the order of the generated list, i.e. the shuffled order.
+     * @param generate Called at most once with the move list to fill, once the TT move has been searched.
+     * @return The next move to search, or NO_MOVE if there are none left.
+     */
+    template<bool ORDERED = false, class Generator>
+    Move next(Generator&& generate) {
+        switch (stage) {
+            case TT_MOVE:
+                stage = GENERATE;
+                if (tt_move != NO_MOVE) {
+                    return tt_move;
+                }
+                [[fallthrough]];
+            case GENERATE:
+                generate(moves);
+                stage = REMAINING;
+                [[fallthrough]];
+            case REMAINING:
+                while (index < moves.size) {
+                    if constexpr (ORDERED) { // Selection sort step; usually we only need the first few moves anyway
+                        int best = index;
+                        for (int i = index + 1; i < moves.size; i++) {
+                            if (moves[i].value > moves[best].value) {
+                                best = i;
+                            }
+                        }
+                        std::swap(moves[index], moves[best]);
+                    }
+                    Move move = moves[index++].move;
+                    if (move != tt_move) {
+                        return move;
+                    }
+                }
+        }
+        return NO_MOVE;
+    }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include "chess.hpp"
+#include "aspiration.h"
+
+constexpr int MTDF_SPREAD = 25; // Distance between the betas of the helper threads, while one bound is still open
+
+/**
+ * Per-depth counters of the null window probes MTD(f) needed to converge.
+ */
+struct MTDF_Stats {
+    uint64_t probes[MAX_SEARCH_DEPTH]{};
+
+    void add(const MTDF_Stats& other) {
+        for (int depth = 0; depth < MAX_SEARCH_DEPTH; depth++) {
+            probes[depth] += other.probes[depth];
+        }
+    }
+
+    void print(int depth) const {
+        std::cout << "info string mtdf depth " << depth << " probes " << probes[depth] << std::endl;
+    }
+};
+
+/**
+ * The bounds on the root score that MTD(f) narrows down with null window probes, shared by all threads of a search.
+ * With a single thread this hands out the usual MTD(f) betas, starting from the guess and moving towards the latest
+ * probe result. With more threads, thread 0 keeps doing that, while the other threads probe betas spread out around the
+ * guess, or evenly between the bounds once both are known.
+ */
+class MTDF_Window {
+
+public:
+    explicit MTDF_Window(Eval_Type guess) : guess(std::clamp<int>(guess, FULL_WINDOW_ALPHA + 1, FULL_WINDOW_BETA)) {
+    }
+
+    /**
+     * @param beta Set to the beta the thread should probe next.
+     * @return false if the bounds already met, i.e. the search is done.
+     */
+    bool next_beta(size_t thread_index, size_t num_threads, Eval_Type& beta) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (lower >= upper) {
+            return false;
+        }
+        int target = guess;
+        if (thread_index > 0) {
+            if (lower > FULL_WINDOW_ALPHA && upper < FULL_WINDOW_BETA) {
+                target = lower + (upper - lower) * (int) thread_index / (int) num_threads;
+            } else { // Alternate above and below the guess: +1, -1, +2, -2, ... times the spread
+                int steps = ((int) thread_index + 1) / 2;
+                target = guess + (thread_index % 2 == 1 ? steps : -steps) * MTDF_SPREAD;
+            }
+        }
+        if (target <= lower) { // A probe at the lower bound itself would just fail high again
+            target = lower + 1;
+        }
+        beta = (Eval_Type) std::min(target, upper);
+        return true;
+    }
+
+    /**
+     * @param move The best move of the probe, only used if the probe failed high.
+     * @return true if this probe made the bounds meet.
+     */
+    bool update(Eval_Type beta, Eval_Type eval, Move move) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (lower >= upper) { // Someone else already finished, the result stays as it is
+            return false;
+        }
+        probes++;
+        if (eval >= beta) {
+            if (eval > lower) {
+                lower = eval;
+                best_move = move;
+            }
+        } else {
+            upper = std::min<int>(upper, eval);
+        }
+        guess = eval;
+        return lower >= upper;
+    }
+
+    [[nodiscard]] Eval_Type value() const {
+        return (Eval_Type) lower; // Equal to upper, unless search instability made the bounds cross
+    }
+
+    [[nodiscard]] Move move() const {
+        return best_move;
+    }
+
+    [[nodiscard]] uint64_t probe_count() const {
+        return probes;
+    }
+
+private:
+    std::mutex lock;
+    int lower = FULL_WINDOW_ALPHA, upper = FULL_WINDOW_BETA;
+    int guess;
+    Move best_move = NO_MOVE;
+    uint64_t probes = 0;
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+#include "aspiration.h"
+
+constexpr int SEED_LANES = 8; // 8 int32 lanes, i.e. exactly one AVX2 register of evals
+
+/**
+ * GCC/Clang vector extensions, one lane per seed. The evals get int32 lanes since the murmur results need more than 16
+ * bits before they get centered.
+ */
+typedef uint64_t Seed_Vector __attribute__((vector_size(SEED_LANES * sizeof(uint64_t))));
+typedef int32_t Eval_Vector __attribute__((vector_size(SEED_LANES * sizeof(int32_t))));
+
+inline Eval_Vector broadcast(int32_t eval) {
+    return Eval_Vector{} + eval;
+}
+
+inline Eval_Vector lane_max(Eval_Vector a, Eval_Vector b) {
+    return a > b ? a : b;
+}
+
+inline bool all_lanes(Eval_Vector mask) {
+    for (int lane = 0; lane < SEED_LANES; lane++) {
+        if (!mask[lane]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Board::eval<Pseudo_random> for all seeds at once, lane i gives exactly what the scalar version gives with seed set to
+ * seeds[i].
+ */
+inline Eval_Vector pseudo_random_evals(uint64_t key, Seed_Vector seeds) {
+    Seed_Vector shufflee = seeds + key;
+    shufflee ^= shufflee >> 33;
+    shufflee *= 0xff51afd7ed558ccdL;
+    shufflee ^= shufflee >> 33;
+    shufflee *= 0xc4ceb9fe1a85ec53L;
+    shufflee ^= shufflee >> 33;
+    Seed_Vector mod_eval = shufflee % (uint64_t) (MAX_EVAL + 1 - MIN_EVAL);
+    return __builtin_convertvector(mod_eval, Eval_Vector) - (MAX_EVAL + 1);
+}
+
+/**
+ * Searches the same tree for several seeds of the pseudo random eval at once, so the move generation, which is most of
+ * the cost, is shared by all of them. Minimax runs per lane; in the alpha-beta version every lane has its own bounds,
+ * and a node only gets cut off once all lanes fail high. Lanes that already failed high keep getting searched along
+ * with the others, but with an empty window, so their result stays a valid lower bound.
+ */
+class Multi_Seed_Search {
+
+    Board board;
+    Seed_Vector seeds{};
+    uint64_t nodes = 0;
+
+    /**
+     * The scalar searchers clamp leaf evals below MIN_EVAL up to it, so the lanes do the same to get their results.
+     */
+    Eval_Vector leaf_evals() {
+        return lane_max(pseudo_random_evals(board.hashKey, seeds), broadcast(MIN_EVAL));
+    }
+
+    Eval_Vector terminal_eval(int depth) {
+        if (board.in_check()) {
+            return broadcast(MIN_EVAL - MAX_MATE_DEPTH);
+        }
+        return broadcast(STALEMATE_SCORE[depth % 2]);
+    }
+
+    Eval_Vector minimax(int depth) {
+        nodes++;
+        if (depth == 0) {
+            return leaf_evals();
+        }
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        if (moves.size == 0) {
+            return terminal_eval(depth);
+        }
+        Eval_Vector eval = broadcast(MIN_EVAL - MAX_MATE_DEPTH);
+        for (auto& move_container : moves) {
+            board.makeMove(move_container.move);
+            eval = lane_max(eval, -minimax(depth - 1));
+            board.unmakeMove(move_container.move);
+        }
+        return eval;
+    }
+
+    Eval_Vector alpha_beta(Eval_Vector alpha, Eval_Vector beta, int depth) {
+        nodes++;
+        if (depth == 0) {
+            return leaf_evals();
+        }
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        if (moves.size == 0) {
+            return terminal_eval(depth);
+        }
+        Eval_Vector eval = broadcast(MIN_EVAL - MAX_MATE_DEPTH);
+        for (auto& move_container : moves) {
+            board.makeMove(move_container.move);
+            eval = lane_max(eval, -alpha_beta(-beta, -alpha, depth - 1));
+            board.unmakeMove(move_container.move);
+            if (all_lanes(eval >= beta)) {
+                break;
+            }
+            alpha = lane_max(alpha, eval);
+        }
+        return eval;
+    }
+
+public:
+    /**
+     * The lanes get the seeds first_seed, first_seed + 1, ..., i.e. the ones a sweep with change_seed goes through.
+     */
+    Multi_Seed_Search(Board& board, uint64_t first_seed) : board(board) {
+        for (int lane = 0; lane < SEED_LANES; lane++) {
+            seeds[lane] = first_seed + lane;
+        }
+        if constexpr (Board::EVAL_MODE != Board::Pseudo_random) {
+            std::cout << "info string multi seed search always uses the pseudo random eval, unlike the other searchers"
+                      << std::endl;
+        }
+    }
+
+    /**
+     * @param use_alpha_beta Per lane alpha-beta instead of plain minimax; both give the same moves and evals.
+     * @return One result per seed, all with the node count and time of the shared search.
+     */
+    template<class Search_Result>
+    std::vector<Search_Result> search(int depth, bool use_alpha_beta) {
+        auto start = std::chrono::high_resolution_clock::now();
+        nodes = 0;
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        Eval_Vector eval = broadcast(FULL_WINDOW_ALPHA);
+        Eval_Vector alpha = broadcast(FULL_WINDOW_ALPHA), beta = broadcast(FULL_WINDOW_BETA);
+        Move best_moves[SEED_LANES];
+        std::fill(std::begin(best_moves), std::end(best_moves), NO_MOVE);
+        for (auto& move_container : moves) {
+            Move move = move_container.move;
+            board.makeMove(move);
+            Eval_Vector inner_eval = use_alpha_beta ? -alpha_beta(-beta, -alpha, depth - 1) : -minimax(depth - 1);
+            board.unmakeMove(move);
+            for (int lane = 0; lane < SEED_LANES; lane++) {
+                if (inner_eval[lane] > eval[lane]) {
+                    eval[lane] = inner_eval[lane];
+                    best_moves[lane] = move;
+                }
+            }
+            alpha = lane_max(alpha, eval);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+
+        std::vector<Search_Result> results(SEED_LANES);
+        for (int lane = 0; lane < SEED_LANES; lane++) {
+            results[lane].nodes = nodes;
+            results[lane].duration = duration.count();
+            results[lane].move = best_moves[lane];
+            results[lane].eval = (Eval_Type) eval[lane];
+            results[lane].depth = depth;
+            std::cout << "info string seed " << seeds[lane] << " depth " << depth << " bestmove "
+                      << convertMoveToUci(best_moves[lane]) << " eval " << eval[lane] << std::endl;
+        }
+        std::cout << "info string multi seed nodes " << nodes << " time " << duration.count() << " nps "
+                  << (uint64_t) (nodes / duration.count()) << " seeds " << SEED_LANES << std::endl;
+        return results;
+    }
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "chess.hpp"
+#include "aspiration.h"
+
+struct Root_Move {
+    Move move = NO_MOVE;
+    Eval_Type score = FULL_WINDOW_ALPHA; // Exact if it is among the best K, otherwise possibly just an upper bound
+    Eval_Type previous_score = FULL_WINDOW_ALPHA;
+    uint64_t nodes = 0; // Of the current iteration, summed over all threads and re-searches
+};
+
+/**
+ * The root moves of a MultiPV search, shared by all threads. Within an iteration, the threads take the moves one after
+ * another, best first by the scores of the previous iteration. A move only needs an exact score if it beats the K-th
+ * best score found so far, so every move gets searched with that as alpha, and with a null window first where the
+ * searcher does PV search. As alpha only ever goes up during an iteration, a move that failed low against an older
+ * alpha can't be among the best K at the end either.
+ *
+ * The parallel drivers of the single PV search keep their root moves here as well, so that all threads go through them
+ * in the same order and agree on which ones are worth helping with, see sort and next_iteration. There the best move
+ * of the previous iteration comes first, the others by the nodes their subtrees took in the previous iteration: a move
+ * that took a lot of nodes to refute is the most likely to become the best move next.
+ */
+class Root_Moves {
+
+public:
+    explicit Root_Moves(Board& board, size_t multi_pv = 1) {
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (auto& move_container : moves) {
+            root_moves.push_back(Root_Move{move_container.move});
+        }
+        this->multi_pv = std::clamp<size_t>(multi_pv, 1, std::max<size_t>(root_moves.size(), 1));
+    }
+
+    /**
+     * Not thread safe, only call this between iterations.
+     */
+    void start_iteration() {
+        for (auto& root_move : root_moves) {
+            root_move.previous_score = root_move.score;
+            root_move.score = FULL_WINDOW_ALPHA;
+        }
+        std::stable_sort(root_moves.begin(), root_moves.end(), [](const Root_Move& a, const Root_Move& b) {
+            return a.previous_score > b.previous_score;
+        });
+        next = 0;
+        alpha = FULL_WINDOW_ALPHA;
+    }
+
+    /**
+     * @param index Set to the index of the next root move to search.
+     * @return false if all root moves of this iteration are taken.
+     */
+    bool next_move(size_t& index) {
+        index = next.fetch_add(1);
+        return index < root_moves.size();
+    }
+
+    [[nodiscard]] Move move(size_t index) const {
+        return root_moves[index].move;
+    }
+
+    /**
+     * The K-th best score so far, or the lowest possible score while there are fewer than K of them.
+     */
+    [[nodiscard]] Eval_Type current_alpha() {
+        std::lock_guard<std::mutex> guard(lock);
+        return alpha;
+    }
+
+    void report(size_t index, Eval_Type score) {
+        std::lock_guard<std::mutex> guard(lock);
+        root_moves[index].score = score;
+        std::vector<Eval_Type> scores;
+        for (const auto& root_move : root_moves) {
+            scores.push_back(root_move.score);
+        }
+        std::nth_element(scores.begin(), scores.begin() + (long) multi_pv - 1, scores.end(), std::greater<>());
+        alpha = scores[multi_pv - 1];
+    }
+
+    /**
+     * Brings a freshly generated root move list into the shared order.
+     */
+    void sort(Movelist& moves) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto& move_container : moves) {
+            auto it = std::find_if(root_moves.begin(), root_moves.end(), [&](const Root_Move& root_move) {
+                return root_move.move == move_container.move;
+            });
+            move_container.value = (int) (root_moves.end() - it); // Moves we don't know of go last
+        }
+        std::stable_sort(moves.begin(), moves.end(), [](const auto& a, const auto& b) {
+            return a.value > b.value;
+        });
+    }
+
+    /**
+     * @param score Mostly just an upper bound, only used to break ties between equal node counts.
+     */
+    void record(Move move, uint64_t nodes, Eval_Type score) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto& root_move : root_moves) {
+            if (root_move.move == move) {
+                root_move.nodes += nodes;
+                root_move.score = score;
+                return;
+            }
+        }
+    }
+
+    /**
+     * Not thread safe, only call this between iterations.
+     */
+    void next_iteration(Move best_move) {
+        std::stable_sort(root_moves.begin(), root_moves.end(), [&](const Root_Move& a, const Root_Move& b) {
+            if ((a.move == best_move) != (b.move == best_move)) {
+                return a.move == best_move;
+            }
+            if (a.nodes != b.nodes) {
+                return a.nodes > b.nodes;
+            }
+            return a.score > b.score;
+        });
+        for (auto& root_move : root_moves) {
+            root_move.nodes = 0;
+            root_move.score = FULL_WINDOW_ALPHA;
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        return root_moves.size();
+    }
+
+    /**
+     * The best K moves of the iteration, best first. Not thread safe, only call this after an iteration.
+     */
+    [[nodiscard]] std::vector<Root_Move> best() const {
+        std::vector<Root_Move> sorted(root_moves);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Root_Move& a, const Root_Move& b) {
+            return a.score > b.score;
+        });
+        sorted.resize(std::min(multi_pv, sorted.size()));
+        return sorted;
+    }
+
+    /**
+     * Prints one info multipv line per pv, with the rest of each pv coming from the TT.
+     */
+    template<class Table>
+    void print(Board& board, Table& table, int depth, uint64_t nodes, double duration) const {
+        int millis = (int) (duration * 1000);
+        size_t pv_index = 1;
+        for (const auto& root_move : best()) {
+            std::cout << "info depth " << depth << " multipv " << pv_index++ << " score cp " << root_move.score / 100
+                      << " time " << millis << " nodes " << nodes << " nps " << (nodes / (millis / 1000 + 1))
+                      << " pv " << convertMoveToUci(root_move.move) << " ";
+            Board copy(board);
+            copy.makeMove(root_move.move);
+            table.print_pv(copy, depth - 1);
+        }
+    }
+
+private:
+    std::vector<Root_Move> root_moves;
+    size_t multi_pv = 1;
+    std::atomic<size_t> next = 0;
+    std::mutex lock;
+    Eval_Type alpha = FULL_WINDOW_ALPHA;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <deque>
+#include <thread>
+#include <utility>
+#include "simple_concurrent_search.h"
+
+constexpr size_t PARALLEL_ASPIRATION_GROUPS = 3; // One group on the previous score and one on either side of it
+
+/**
+ * Lazy SMP where the threads are split into groups and every group searches the root with its own window. The windows
+ * don't overlap and together cover all scores, so (barring search instability) exactly one group finds the exact
+ * score, while the others fail high or low, which is usually a lot cheaper. All groups share the TT, so the bounds of
+ * the failing groups still help the others.
+ * Each group has its own finished flag, so a group that fails high or low only stops itself, and the first group with
+ * an exact score stops everyone.
+ */
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
+class Parallel_Aspiration_Search {
+
+    size_t num_groups;
+    std::deque<std::atomic<bool>> finished; // One per group; a deque since atomics can't be moved when the container grows
+    std::vector<std::vector<Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>>> groups;
+    Board& board;
+    Locking_TT<strategy>& table;
+    uint64_t fallbacks[MAX_SEARCH_DEPTH]{};
+    uint64_t total_nodes = 0; // Over all iterations of all searches so far
+
+    /**
+     * The inner groups get adjacent windows of ASPIRATION_DELTA around the previous score, the two outermost groups
+     * everything beyond that. Group i covers the scores from bounds[i] to bounds[i + 1] - 1, i.e. searches with
+     * alpha = bounds[i] - 1 and beta = bounds[i + 1].
+     */
+    [[nodiscard]] std::vector<std::pair<Eval_Type, Eval_Type>> split_windows(Eval_Type previous_eval, int depth) const {
+        std::vector<std::pair<Eval_Type, Eval_Type>> windows(num_groups, {FULL_WINDOW_ALPHA, FULL_WINDOW_BETA});
+        if (!USE_ASPIRATION_WINDOWS || depth < ASPIRATION_MIN_DEPTH || std::abs(previous_eval) > MAX_EVAL) {
+            return windows; // Every group gets the full window, i.e. this is plain Lazy SMP
+        }
+        std::vector<int> bounds(num_groups + 1);
+        bounds[0] = FULL_WINDOW_ALPHA + 1;
+        bounds[num_groups] = FULL_WINDOW_BETA;
+        for (size_t i = 1; i < num_groups; i++) {
+            int bound = previous_eval + ((int) (2 * i) - (int) num_groups) * ASPIRATION_DELTA / 2;
+            bounds[i] = std::clamp(bound, bounds[i - 1] + 1, (int) FULL_WINDOW_BETA - 1);
+        }
+        for (size_t i = 0; i < num_groups; i++) {
+            windows[i] = {(Eval_Type) (bounds[i] - 1), (Eval_Type) bounds[i + 1]};
+        }
+        return windows;
+    }
+
+    /**
+     * Runs all groups on their windows until one of them gets an exact score, or all of them failed.
+     * @return The index of the group with the exact score, or -1 if there is none.
+     */
+    template<class Search_Result, bool PV_Search>
+    int search_groups(const std::vector<std::pair<Eval_Type, Eval_Type>>& windows, int depth,
+                      std::vector<Search_Result>& results, std::atomic<uint64_t>& node_count) {
+        std::deque<std::atomic<size_t>> returned; // How many threads of each group are done
+        std::vector<std::thread> search_threads;
+        for (size_t group = 0; group < num_groups; group++) {
+            finished[group] = false;
+            results[group] = Search_Result{};
+            returned.emplace_back(0);
+        }
+        for (size_t group = 0; group < num_groups; group++) {
+            for (auto& searcher : groups[group]) {
+                search_threads.emplace_back([&, group, &searcher = searcher] {
+                    auto [alpha, beta] = windows[group];
+                    searcher.template root_max<Search_Result, PV_Search>(alpha, beta, depth, results[group], node_count);
+                    // The last thread of a group to return sees all writes of the group, in particular its result
+                    if (returned[group].fetch_add(1) + 1 == groups[group].size()) {
+                        const Search_Result& result = results[group];
+                        if (result.depth == depth && result.eval > alpha && result.eval < beta) {
+                            for (auto& flag : finished) { // We have the exact score, so everyone else can stop
+                                flag = true;
+                            }
+                        }
+                    }
+                });
+            }
+        }
+        for (auto& thread : search_threads) {
+            thread.join();
+        }
+
+        for (size_t group = 0; group < num_groups; group++) {
+            auto [alpha, beta] = windows[group];
+            const Search_Result& result = results[group];
+            if (result.depth == depth && result.eval > alpha && result.eval < beta) { // Aborted groups never wrote theirs
+                return (int) group;
+            }
+        }
+        return -1;
+    }
+
+public:
+    Parallel_Aspiration_Search(size_t num_threads, size_t num_groups, Board& board, Locking_TT<strategy>& table)
+            : num_groups(std::clamp<size_t>(num_groups, 1, num_threads)), board(board), table(table) {
+        for (size_t group = 0; group < this->num_groups; group++) {
+            finished.emplace_back(false);
+            size_t group_size = num_threads / this->num_groups + (group < num_threads % this->num_groups ? 1 : 0);
+            groups.emplace_back(group_size, Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>(board, table, finished.back()));
+        }
+    }
+
+    [[nodiscard]] uint64_t get_total_nodes() const {
+        return total_nodes;
+    }
+
+    /**
+     *
+     * @tparam Search_Result
+     * @tparam PV_Search
+     * @tparam OUTPUT Print the result and the stats of every iteration. Bench turns this off.
+     * @param up_to_depth Search for each depth from 1 to up_to_depth through iterative deepening.
+     * @return
+     */
+    template<class Search_Result, bool PV_Search, bool OUTPUT = true>
+    Search_Result parallel_search(int up_to_depth) {
+        Search_Result result;
+        std::vector<Search_Result> results(num_groups);
+        for (int depth = 1; depth <= up_to_depth; depth++) {
+            auto windows = split_windows(result.eval, depth); // Around the score of the previous iteration
+            std::atomic<uint64_t > node_count = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            int exact_group = search_groups<Search_Result, PV_Search>(windows, depth, results, node_count);
+            if (exact_group == -1) { // Search instability, every group failed; so all groups try the full window
+                fallbacks[depth]++;
+                windows.assign(num_groups, {FULL_WINDOW_ALPHA, FULL_WINDOW_BETA});
+                exact_group = search_groups<Search_Result, PV_Search>(windows, depth, results, node_count);
+                exact_group = std::max(exact_group, 0); // Can only still fail if the root has no legal moves
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+
+            result = results[exact_group];
+            result.duration = duration.count();
+            result.nodes = node_count;
+            total_nodes += result.nodes;
+            if constexpr (OUTPUT) {
+                result.print_uci();
+                table.print_pv(board, depth);
+                std::cout << "info string parallel aspiration depth " << depth << " group " << exact_group << " of "
+                          << num_groups << " window " << windows[exact_group].first << " "
+                          << windows[exact_group].second << " fallbacks " << fallbacks[depth] << std::endl;
+            }
+        }
+        return result;
+    }
+};
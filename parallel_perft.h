@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "perft.h"
+
+/**
+ * A subtree of the split: the moves leading from the root to it.
+ */
+struct Perft_Task {
+    std::vector<Move> moves;
+};
+
+/**
+ * Per-thread task deques. A thread takes tasks from the front of its own deque and, once that is empty, steals from the
+ * back of the others. All tasks exist before the threads start, so the pool is done once all deques are empty.
+ */
+class Work_Stealing_Queue {
+
+    struct alignas(64) Thread_Queue {
+        std::mutex lock;
+        std::deque<Perft_Task> tasks;
+    };
+
+    std::deque<Thread_Queue> queues; // A deque since the mutexes can't be moved
+    std::atomic<uint64_t> steals = 0;
+
+public:
+    explicit Work_Stealing_Queue(size_t num_threads) : queues(num_threads) {
+    }
+
+    /**
+     * Not thread safe, only call this before the threads start.
+     */
+    void distribute(std::vector<Perft_Task>& tasks) {
+        for (size_t i = 0; i < tasks.size(); i++) {
+            queues[i % queues.size()].tasks.push_back(std::move(tasks[i]));
+        }
+    }
+
+    std::optional<Perft_Task> next(size_t thread_index) {
+        {
+            Thread_Queue& own = queues[thread_index];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                Perft_Task task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return task;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            Thread_Queue& victim = queues[(thread_index + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                Perft_Task task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                steals++;
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] uint64_t steal_count() const {
+        return steals;
+    }
+};
+
+/**
+ * Perft with the tree split split_depth plies below the root; the subtrees get searched by a pool of threads, each with
+ * its own board, all sharing the perft table.
+ */
+class Parallel_Perft {
+
+    struct Thread_Stats {
+        uint64_t nodes = 0;
+        uint64_t tasks = 0;
+        double busy_time = 0;
+        Perft_TT_Stats tt_stats; // Copied from the thread's PerftTest once it is done
+    };
+
+    Perft_TT& table;
+    size_t num_threads;
+    int split_depth;
+    Perft_TT_Stats tt_stats; // Of the last perft, merged over all threads
+
+    void collect_tasks(Board& board, int depth, std::vector<Move>& moves_so_far, std::vector<Perft_Task>& tasks) {
+        if (depth == 0) {
+            tasks.push_back(Perft_Task{moves_so_far});
+            return;
+        }
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (int i = 0; i < moves.size; i++) {
+            Move move = moves[i].move;
+            moves_so_far.push_back(move);
+            board.makeMove(move);
+            collect_tasks(board, depth - 1, moves_so_far, tasks);
+            board.unmakeMove(move);
+            moves_so_far.pop_back();
+        }
+    }
+
+    void work(Board root, int depth, Work_Stealing_Queue& queue, size_t thread_index, Thread_Stats& stats,
+              std::atomic<uint64_t>& total_nodes) {
+        PerftTest<Perft_TT> perft_test(table);
+        while (auto task = queue.next(thread_index)) {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (Move move : task->moves) {
+                root.makeMove(move);
+            }
+            uint64_t nodes = perft_test.hash_perft(root, depth - (int) task->moves.size());
+            for (auto it = task->moves.rbegin(); it != task->moves.rend(); it++) {
+                root.unmakeMove(*it);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            stats.nodes += nodes;
+            stats.tasks++;
+            stats.busy_time += duration.count();
+        }
+        stats.tt_stats = perft_test.get_tt_stats();
+        total_nodes += stats.nodes;
+    }
+
+public:
+    Parallel_Perft(Perft_TT& table, size_t num_threads, int split_depth = 1)
+            : table(table), num_threads(std::max<size_t>(num_threads, 1)), split_depth(std::max(split_depth, 1)) {
+    }
+
+    uint64_t perft(Board& board, int depth) {
+        if (depth <= split_depth) { // Nothing worth splitting
+            PerftTest<Perft_TT> perft_test(table);
+            uint64_t nodes = perft_test.hash_perft(board, depth);
+            tt_stats = perft_test.get_tt_stats();
+            return nodes;
+        }
+        std::vector<Perft_Task> tasks;
+        std::vector<Move> moves_so_far;
+        collect_tasks(board, split_depth, moves_so_far, tasks);
+        size_t task_count = tasks.size();
+        Work_Stealing_Queue queue(num_threads);
+        queue.distribute(tasks);
+
+        std::atomic<uint64_t> total_nodes = 0;
+        std::vector<Thread_Stats> stats(num_threads);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < num_threads; i++) {
+            threads.emplace_back(&Parallel_Perft::work, this, board, depth, std::ref(queue), i, std::ref(stats[i]),
+                                 std::ref(total_nodes));
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+
+        tt_stats = Perft_TT_Stats{};
+        for (size_t i = 0; i < num_threads; i++) {
+            tt_stats.add(stats[i].tt_stats);
+            std::cout << "thread " << std::setw(3) << i << " tasks " << std::setw(6) << stats[i].tasks << " nodes "
+                      << std::setw(15) << stats[i].nodes << " nps " << std::setw(12)
+                      << (uint64_t) (stats[i].nodes / (stats[i].busy_time + 1e-9)) << std::endl;
+        }
+        std::cout << "depth " << depth << " split depth " << split_depth << " tasks " << task_count << " steals "
+                  << queue.steal_count() << " nodes " << total_nodes << " time " << duration.count() << " nps "
+                  << (uint64_t) (total_nodes / duration.count()) << std::endl;
+        return total_nodes;
+    }
+
+    [[nodiscard]] const Perft_TT_Stats& get_tt_stats() const {
+        return tt_stats;
+    }
+
+    static void start_pos_perfts(size_t num_threads, int up_to_depth = 10, uint64_t table_size_in_mb = 1024) {
+        Perft_TT perftTT{table_size_in_mb};
+        Parallel_Perft parallel_perft(perftTT, num_threads);
+        for (int depth = 1; depth <= up_to_depth; depth++) {
+            Board board = Board(DEFAULT_POS);
+            uint64_t nodes = parallel_perft.perft(board, depth);
+            if (nodes != START_POS_PERFT_RESULTS[depth]) {
+                std::cout << "Wrong node count at depth " << depth << ": " << nodes << " instead of "
+                          << START_POS_PERFT_RESULTS[depth] << std::endl;
+            }
+            perftTT.print_size(parallel_perft.get_tt_stats());
+        }
+    }
+};
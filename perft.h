@@ -5,16 +5,21 @@
 #include <iostream>
 #include <iomanip>
 #include "perft_tt.h"
+#include "legal_move_counter.h"
 #include "chess-library/src/chess.hpp"
 
 using namespace Chess;
 
+constexpr uint64_t START_POS_PERFT_RESULTS[] = { 1, 20, 400, 8902, 197281, 4865609, 119060324, 3195901860,
+                                                84998978956, 2439530234167, 69352859712417 };
+
 template<class T>
 class PerftTest
 {
 private:
     Perft_TT& simpleTT;
     uint64_t position_generations = 0;
+    Perft_TT_Stats tt_stats;
 public:
     explicit PerftTest(T& TT) : simpleTT(TT) {
     }
@@ -23,8 +28,15 @@ public:
         if (depth == 0) {
             return 1;
         }
-        if (depth > 1 && simpleTT.contains(board.hashKey + depth)) {
-            return simpleTT.at(board.hashKey + depth);
+        if (depth == 1) { // Bulk counting, the moves of the last ply never get generated
+            position_generations++;
+            return count_legal_moves(board);
+        }
+        uint64_t stored_nodes;
+        tt_stats.probes[depth]++;
+        if (simpleTT.get_if_exists(board.hashKey, depth, stored_nodes)) {
+            tt_stats.hits[depth]++;
+            return stored_nodes;
         }
 
         uint64_t nodes = 0;
@@ -32,18 +44,14 @@ public:
         Movegen::legalmoves<ALL>(board, moves);
         position_generations++;
 
-        if (depth == 1)
-        {
-            nodes = moves.size;
-        } else {
-            for (int i = 0; i < moves.size; i++) {
-                Move &move = moves[i].move;
-                board.makeMove(move);
-                nodes += hash_perft(board, depth - 1);
-                board.unmakeMove(move);
-            }
-            simpleTT.emplace(board.hashKey + depth, nodes);
+        for (int i = 0; i < moves.size; i++) {
+            Move &move = moves[i].move;
+            board.makeMove(move);
+            nodes += hash_perft(board, depth - 1);
+            board.unmakeMove(move);
         }
+        simpleTT.emplace(board.hashKey, depth, nodes);
+        tt_stats.writes++;
         return nodes;
     }
 
@@ -55,14 +63,13 @@ public:
      */
     uint64_t perft(Board &board, int depth)
     {
-        Movelist moves;
-        Movegen::legalmoves<ALL>(board, moves);
-
         if (depth == 1)
         {
-            return int(moves.size);
+            return count_legal_moves(board);
         }
 
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
         uint64_t nodes = 0;
 
         for (int i = 0; i < int(moves.size); i++)
@@ -106,15 +113,21 @@ public:
         return n;
     }
 
+    [[nodiscard]] uint64_t get_position_generations() const {
+        return position_generations;
+    }
+
+    [[nodiscard]] const Perft_TT_Stats& get_tt_stats() const {
+        return tt_stats;
+    }
+
     static void start_pos_perfts() {
-        uint64_t results[] = { 1, 20, 400, 8902, 197281, 4865609, 119060324, 3195901860,
-                               84998978956, 2439530234167, 69352859712417 };
         Perft_TT perftTT{};
         for (int depth = 0; depth < 11; depth++) {
             Board board = Board(DEFAULT_POS);
             auto perft_improved = PerftTest<Perft_TT>(perftTT);
-            perft_improved.testPositionPerft(board, depth, results[depth]);
-            perftTT.print_size();
+            perft_improved.testPositionPerft(board, depth, START_POS_PERFT_RESULTS[depth]);
+            perftTT.print_size(perft_improved.get_tt_stats());
         }
     }
 };
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "perft.h"
+
+/**
+ * Perft for every root move on its own, the usual way to narrow down a move generator bug against a reference engine.
+ */
+inline uint64_t perft_divide(Board& board, int depth, Perft_TT& table) {
+    PerftTest<Perft_TT> perft_test(table);
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t total = 0;
+    Movelist moves;
+    if (depth < 1) { // Just the position itself, there are no root moves to divide by
+        total = 1;
+    } else {
+        Movegen::legalmoves<ALL>(board, moves);
+    }
+    for (int i = 0; i < moves.size; i++) {
+        Move move = moves[i].move;
+        board.makeMove(move);
+        uint64_t nodes = depth > 1 ? perft_test.hash_perft(board, depth - 1) : 1;
+        board.unmakeMove(move);
+        std::cout << convertMoveToUci(move) << ": " << nodes << std::endl;
+        total += nodes;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    std::cout << std::endl << "Nodes searched: " << total << std::endl;
+    std::cout << "info string perft depth " << depth << " nodes " << total << " time " << duration.count() << " nps "
+              << (uint64_t) (total / (duration.count() + 1e-9)) << std::endl;
+    return total;
+}
+
+/**
+ * A line of the standard perft suite, e.g. "<fen> ;D1 20 ;D2 400 ;D3 8902".
+ */
+struct EPD_Position {
+    std::string fen;
+    std::vector<std::pair<int, uint64_t>> expected; // Depth and node count
+
+    static EPD_Position parse(const std::string& line) {
+        EPD_Position position;
+        std::stringstream fields(line);
+        std::string field;
+        std::getline(fields, field, ';');
+        position.fen = field.substr(0, field.find_last_not_of(' ') + 1);
+        while (std::getline(fields, field, ';')) {
+            std::stringstream depth_and_nodes(field);
+            std::string depth;
+            uint64_t nodes;
+            if (depth_and_nodes >> depth >> nodes && depth.size() > 1 && depth[0] == 'D') {
+                position.expected.emplace_back(std::stoi(depth.substr(1)), nodes);
+            }
+        }
+        return position;
+    }
+};
+
+/**
+ * Runs every position of an EPD perft suite through all its expected depths up to max_depth, starting the next depth
+ * only while the position is still within its time limit. The results go to a JSON file, per position and depth with
+ * nodes, time and nps and whether the count matched.
+ * @return true if every count matched.
+ */
+inline bool run_perft_suite(const std::string& epd_file, int max_depth, double seconds_per_position,
+                            const std::string& json_file, Perft_TT& table) {
+    std::ifstream epd(epd_file);
+    std::ofstream json(json_file);
+    PerftTest<Perft_TT> perft_test(table);
+    bool all_passed = true;
+    uint64_t total_nodes = 0;
+    double total_time = 0;
+    bool first_position = true;
+    json << "{\n  \"positions\": [";
+    for (std::string line; std::getline(epd, line);) {
+        if (line.empty()) {
+            continue;
+        }
+        EPD_Position position = EPD_Position::parse(line);
+        Board board(position.fen);
+        json << (first_position ? "\n" : ",\n") << "    {\"fen\": \"" << position.fen << "\", \"depths\": [";
+        first_position = false;
+        double position_time = 0;
+        bool first_depth = true;
+        for (auto [depth, expected] : position.expected) {
+            if (depth > max_depth || position_time >= seconds_per_position) {
+                break;
+            }
+            table.clear(); // Otherwise the earlier depths make the timing of this one meaningless
+            auto start = std::chrono::high_resolution_clock::now();
+            uint64_t nodes = perft_test.hash_perft(board, depth);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            bool passed = nodes == expected;
+            all_passed &= passed;
+            position_time += duration.count();
+            total_nodes += nodes;
+            total_time += duration.count();
+            json << (first_depth ? "" : ", ") << "{\"depth\": " << depth << ", \"nodes\": " << nodes << ", \"expected\": "
+                 << expected << ", \"time\": " << duration.count() << ", \"nps\": "
+                 << (uint64_t) (nodes / (duration.count() + 1e-9)) << ", \"passed\": " << (passed ? "true" : "false")
+                 << "}";
+            first_depth = false;
+            if (!passed) {
+                std::cout << "Wrong node count " << nodes << " instead of " << expected << " at depth " << depth
+                          << " fen " << position.fen << std::endl;
+            }
+        }
+        json << "]}";
+    }
+    json << "\n  ],\n  \"total_nodes\": " << total_nodes << ",\n  \"total_time\": " << total_time
+         << ",\n  \"nps\": " << (uint64_t) (total_nodes / (total_time + 1e-9)) << ",\n  \"passed\": "
+         << (all_passed ? "true" : "false") << "\n}" << std::endl;
+    std::cout << "info string perft suite nodes " << total_nodes << " time " << total_time << " passed "
+              << (all_passed ? "true" : "false") << std::endl;
+    return all_passed;
+}
@@ -1,109 +1,168 @@
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include <bit>
+#include <span>
+
+constexpr int MAX_PERFT_DEPTH = 64;
+
+/**
+ * Probe, hit and write counters of one perft thread. Every thread counts for itself, so that the threads don't fight
+ * over the cache lines of shared counters, and the counters get merged for printing.
+ */
+struct Perft_TT_Stats {
+    uint64_t probes[MAX_PERFT_DEPTH]{};
+    uint64_t hits[MAX_PERFT_DEPTH]{};
+    uint64_t writes = 0;
+
+    void add(const Perft_TT_Stats& other) {
+        for (int depth = 0; depth < MAX_PERFT_DEPTH; depth++) {
+            probes[depth] += other.probes[depth];
+            hits[depth] += other.hits[depth];
+        }
+        writes += other.writes;
+    }
+};
 
+/**
+ * Perft table, by position and depth, that can be shared by any number of threads without locks. Each entry is two
+ * 64 bit words: the data, i.e. the node count and the depth, and the key XOR the data. A reader only accepts an entry
+ * if XORing the two words gives back its key, so an entry that is torn by a concurrent write just looks like a miss.
+ */
 class Perft_TT {
 
 private:
     static constexpr uint32_t entries_per_bucket = 4;
+    static constexpr uint64_t depth_bits = 8;
+    static constexpr uint64_t depth_mask = (1 << depth_bits) - 1;
 
     struct Entry {
-        uint64_t key;
-        uint64_t value;
+        std::atomic<uint64_t> key_xor_data = 0;
+        std::atomic<uint64_t> data = 0; // Node count in the upper 56 bits, depth in the lower 8
     };
 
     struct alignas(64) Bucket {
         Entry entries[entries_per_bucket];
     };
 
+    static inline uint64_t pack(uint64_t nodes, int depth) {
+        return (nodes << depth_bits) | (uint64_t) depth;
+    }
 
+    static inline uint64_t unpack_nodes(uint64_t data) {
+        return data >> depth_bits;
+    }
 
 public:
-    Perft_TT() : table(size) {
+    explicit Perft_TT(uint64_t size_in_mb = 16) :
+            size((1 << 20) * std::bit_floor(std::max<uint64_t>(size_in_mb, 1)) / sizeof(Bucket)), mask(size - 1),
+            storage(size), table(storage) {
+    }
+
+    /**
+     * A table in memory owned by the caller, e.g. a memory mapped file, which has to be 64 byte aligned. Zeroed memory
+     * is an empty table, anything else gets used as it is.
+     */
+    Perft_TT(void* memory, uint64_t size_in_bytes) : size(std::bit_floor(size_in_bytes / sizeof(Bucket))),
+            mask(size - 1), table(static_cast<Bucket*>(memory), size) {
     }
 
-    void print_size() {
+    /**
+     * Occupancy by depth, and the writes and the hit rate by depth of the given counters. This method is not thread safe
+     * because there's not really a reason to make it.
+     */
+    void print_size(const Perft_TT_Stats& stats) const {
+        uint64_t occupancy[MAX_PERFT_DEPTH]{};
         uint64_t num_elements = 0;
-        for (Bucket& bucket : table) {
-            for (auto & entry : bucket.entries) {
-                if (entry.key != 0) {
+        for (const Bucket& bucket : table) {
+            for (const auto& entry : bucket.entries) {
+                uint64_t data = entry.data.load(std::memory_order_relaxed);
+                if (data != 0) {
                     num_elements++;
+                    occupancy[std::min<uint64_t>(data & depth_mask, MAX_PERFT_DEPTH - 1)]++;
                 }
             }
         }
-        std::cout << "Table elements: " << num_elements << ", missed writes: " << missed_writes << " bucket count "
-                  << table.size() << ", bucket capacity: " << table.capacity() << std::endl;
-    }
-
-    /*void emplace(uint64_t key, uint64_t value) {
-        auto & entries = table[pos(key)].entries;
-        for (int i = 0; i < 4; i++) {
-            auto & entry = entries[i];
-            if (entry.value < value || i == 3) { // last slot is always replace
-                std::swap(entry.value, value);
-                std::swap(entry.key, key);
-            }
-        }
-    }*/
-
-    void emplace(uint64_t key, uint64_t value) {
-        auto & entries = table[pos(key)].entries;
-        bool swapped = false;
-        for (int i = 0; i < 4; i++) {
-            auto & entry = entries[i];
-            if (entry.value < value) { // last slot is always replace
-                std::swap(entry.value, value);
-                std::swap(entry.key, key);
-                swapped = true;
+        std::cout << "Table elements: " << num_elements << " of " << size * entries_per_bucket << ", writes: "
+                  << stats.writes << ", bucket count " << table.size() << std::endl;
+        std::cout << "depth\tentries\tprobes\thits\thit rate" << std::endl;
+        for (int depth = 0; depth < MAX_PERFT_DEPTH; depth++) {
+            uint64_t probes = stats.probes[depth], hits = stats.hits[depth];
+            if (occupancy[depth] == 0 && probes == 0) {
+                continue;
             }
-        }
-        if (!swapped) {
-            missed_writes++;
-            auto & entry = entries[2 + (missed_writes & 1)];
-            std::swap(entry.value, value);
-            std::swap(entry.key, key);
+            std::cout << depth << "\t" << occupancy[depth] << "\t" << probes << "\t" << hits << "\t"
+                      << (probes == 0 ? 0.0 : (double) hits / (double) probes) << std::endl;
         }
     }
 
-    /*void emplace(uint64_t key, uint64_t value) {
-        auto & entries = table[pos(key)].entries;
-        for (int i = 0; i < 4; i++) {
-            auto & entry = entries[i];
-            if (entry.value < value) {
-                std::swap(entry.value, value);
-                std::swap(entry.key, key);
+    /**
+     * Overwrites the entry of the same position and depth if there is one, otherwise the entry with the fewest nodes,
+     * i.e. the one that is cheapest to recompute. Racing writers can lose an entry but never corrupt one.
+     */
+    void emplace(uint64_t key, int depth, uint64_t nodes) {
+        auto& entries = table[pos(key, depth)].entries;
+        Entry* replace = &entries[0];
+        uint64_t fewest_nodes = UINT64_MAX;
+        for (auto& entry : entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            uint64_t entry_key = entry.key_xor_data.load(std::memory_order_relaxed) ^ data;
+            if (entry_key == key && (data & depth_mask) == (uint64_t) depth) {
+                replace = &entry;
+                break;
             }
-        }
-        missed_writes += value == 0 ? 0 : 1;
-    }*/
-
-    uint64_t at(uint64_t key) {
-        for (auto& entry : table[pos(key)].entries) {
-            if (entry.key == key) {
-                return entry.value;
+            if (unpack_nodes(data) < fewest_nodes) {
+                fewest_nodes = unpack_nodes(data);
+                replace = &entry;
             }
         }
-        return 0;
+        uint64_t data = pack(nodes, depth);
+        replace->data.store(data, std::memory_order_relaxed);
+        replace->key_xor_data.store(key ^ data, std::memory_order_relaxed);
     }
 
-    bool contains(uint64_t key) {
-        for (auto& entry : table[pos(key)].entries) { // NOLINT(readability-use-anyofallof)
-            if (entry.key == key) {
+    /**
+     * Returns true and puts the node count into the third parameter reference, if such an entry exists, and false
+     * otherwise.
+     */
+    bool get_if_exists(uint64_t key, int depth, uint64_t& nodes) {
+        for (auto& entry : table[pos(key, depth)].entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            uint64_t key_xor_data = entry.key_xor_data.load(std::memory_order_relaxed);
+            if ((key_xor_data ^ data) == key && (data & depth_mask) == (uint64_t) depth) {
+                nodes = unpack_nodes(data);
                 return true;
             }
         }
         return false;
     }
 
-    static inline uint64_t pos(uint64_t key) {
-        return key % size; // this is a compile-time constant and gets compiled to either a bit and or an efficient version of this
+    /*
+     * Like in the search tables, the entries of a position for different depths go to neighbouring buckets.
+     */
+    [[nodiscard]] inline uint64_t pos(uint64_t key, int depth) const {
+        return (key - depth) & mask;
     }
 
-private:
-    static constexpr uint32_t size = 2 << 17;
-    std::vector<Bucket> table;
+    /**
+     * Not thread safe, only call this while no perft is running.
+     */
+    void clear() {
+        for (Bucket& bucket : table) {
+            for (Entry& entry : bucket.entries) {
+                entry.key_xor_data = 0;
+                entry.data = 0;
+            }
+        }
+    }
 
-    uint64_t missed_writes = 0;
-};
\ No newline at end of file
+private:
+    uint64_t size;
+    uint64_t mask;
+    std::vector<Bucket> storage; // Empty if the memory belongs to someone else
+    std::span<Bucket> table;
+};
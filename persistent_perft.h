@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "perft.h"
+
+constexpr uint32_t PERFT_FILE_VERSION = 1; // Bump this whenever the file layout or the perft table entries change
+constexpr uint64_t PERFT_FILE_PAGE = 4096;
+
+/**
+ * Node counts of a few positions that exercise castling, en passant, promotions and pins, together with their hash
+ * keys. A cache file only gets reused by a build with the same fingerprint, i.e. with the same move generator and the
+ * same Zobrist keys, as the table entries are only meaningful for those.
+ */
+inline uint64_t movegen_fingerprint() {
+    static const std::string positions[] = { DEFAULT_POS,
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1" };
+    Perft_TT table(1);
+    PerftTest<Perft_TT> perft_test(table);
+    uint64_t fingerprint = PERFT_FILE_VERSION;
+    for (const auto& fen : positions) {
+        Board board(fen);
+        fingerprint = (fingerprint ^ board.hashKey) * 0x9E3779B97F4A7C15ULL;
+        fingerprint = (fingerprint ^ perft_test.hash_perft(board, 3)) * 0x9E3779B97F4A7C15ULL;
+    }
+    return fingerprint;
+}
+
+/**
+ * Perft for runs that take hours or days. The tree gets split split_depth plies below the root into units, and the node
+ * counts of the finished units live in a memory mapped file together with the perft table, so that a run that gets
+ * killed can be restarted with the same arguments and continues where it stopped, with the table as full as it was.
+ * The file gets synced to disk every checkpoint interval. A torn table entry after a crash just looks like a miss, see
+ * Perft_TT, and a unit count is a single word, so whatever made it to disk can be trusted.
+ * The file is only reused if the version, the move generator fingerprint, the root position, the depths and the table
+ * size all match; otherwise it gets started from scratch.
+ */
+class Persistent_Perft {
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t split_depth;
+        uint64_t fingerprint;
+        uint64_t root_key;
+        uint64_t depth;
+        uint64_t num_units;
+        uint64_t table_bytes;
+    };
+
+    static constexpr char MAGIC[8] = "PERFT";
+
+    std::string file_name;
+    uint64_t table_bytes;
+    int file = -1;
+    char* mapping = nullptr;
+    uint64_t mapping_size = 0;
+
+    static uint64_t round_to_pages(uint64_t bytes) {
+        return (bytes + PERFT_FILE_PAGE - 1) / PERFT_FILE_PAGE * PERFT_FILE_PAGE;
+    }
+
+    static void collect_units(Board& board, int depth, std::vector<Move>& moves_so_far,
+                              std::vector<std::vector<Move>>& units) {
+        if (depth == 0) {
+            units.push_back(moves_so_far);
+            return;
+        }
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (int i = 0; i < moves.size; i++) {
+            Move move = moves[i].move;
+            moves_so_far.push_back(move);
+            board.makeMove(move);
+            collect_units(board, depth - 1, moves_so_far, units);
+            board.unmakeMove(move);
+            moves_so_far.pop_back();
+        }
+    }
+
+    /**
+     * Maps the file, after clearing it if its header doesn't match the expected one.
+     * @return false if the file can't be created or mapped.
+     */
+    bool open_file(const Header& expected) {
+        mapping_size = round_to_pages(sizeof(Header)) + round_to_pages(expected.num_units * sizeof(uint64_t))
+                       + table_bytes;
+        file = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file < 0) {
+            std::cout << "info string can't open perft cache " << file_name << std::endl;
+            return false;
+        }
+        Header existing{};
+        struct stat file_stat{};
+        bool reuse = fstat(file, &file_stat) == 0 && (uint64_t) file_stat.st_size == mapping_size
+                     && pread(file, &existing, sizeof(Header), 0) == sizeof(Header)
+                     && std::memcmp(&existing, &expected, sizeof(Header)) == 0;
+        if (!reuse) {
+            if (file_stat.st_size > 0) {
+                std::cout << "info string perft cache " << file_name << " is from a different build or run, starting over"
+                          << std::endl;
+            }
+            if (ftruncate(file, 0) != 0 || ftruncate(file, (off_t) mapping_size) != 0) { // Truncating first zeroes it
+                std::cout << "info string can't resize perft cache " << file_name << std::endl;
+                return false;
+            }
+        }
+        void* memory = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (memory == MAP_FAILED) {
+            std::cout << "info string can't map perft cache " << file_name << std::endl;
+            return false;
+        }
+        mapping = static_cast<char*>(memory);
+        if (!reuse) { // The header goes in last, a file that got killed while being set up doesn't look valid
+            msync(mapping, mapping_size, MS_SYNC);
+            std::memcpy(mapping, &expected, sizeof(Header));
+            msync(mapping, PERFT_FILE_PAGE, MS_SYNC);
+        }
+        return true;
+    }
+
+    void close_file() {
+        if (mapping) {
+            msync(mapping, mapping_size, MS_SYNC);
+            munmap(mapping, mapping_size);
+            mapping = nullptr;
+        }
+        if (file >= 0) {
+            close(file);
+            file = -1;
+        }
+    }
+
+public:
+    /**
+     * @param table_size_in_mb Has to be the same when resuming, otherwise the file gets started from scratch.
+     */
+    Persistent_Perft(std::string file_name, uint64_t table_size_in_mb)
+            : file_name(std::move(file_name)),
+              table_bytes((1 << 20) * std::bit_floor(std::max<uint64_t>(table_size_in_mb, 1))) {
+    }
+
+    ~Persistent_Perft() {
+        close_file();
+    }
+
+    Persistent_Perft(const Persistent_Perft&) = delete;
+    Persistent_Perft& operator=(const Persistent_Perft&) = delete;
+
+    /**
+     * @return The node count, or 0 if the file couldn't be used.
+     */
+    uint64_t perft(Board& board, int depth, size_t num_threads, int split_depth = 2, double checkpoint_seconds = 60) {
+        split_depth = std::clamp(split_depth, 0, std::max(depth - 1, 0));
+        num_threads = std::max<size_t>(num_threads, 1);
+        std::vector<std::vector<Move>> units;
+        std::vector<Move> moves_so_far;
+        collect_units(board, split_depth, moves_so_far, units);
+
+        Header expected{};
+        std::memcpy(expected.magic, MAGIC, sizeof(MAGIC));
+        expected.version = PERFT_FILE_VERSION;
+        expected.split_depth = split_depth;
+        expected.fingerprint = movegen_fingerprint();
+        expected.root_key = board.hashKey;
+        expected.depth = depth;
+        expected.num_units = units.size();
+        expected.table_bytes = table_bytes;
+        if (!open_file(expected)) {
+            close_file();
+            return 0;
+        }
+        // A unit count is stored plus one, so that zero, which is what a new file contains, means not done yet
+        auto* unit_counts = reinterpret_cast<std::atomic<uint64_t>*>(mapping + round_to_pages(sizeof(Header)));
+        Perft_TT table(mapping + mapping_size - table_bytes, table_bytes);
+
+        std::atomic<uint64_t> done_units = 0, resumed_units = 0;
+        for (size_t i = 0; i < units.size(); i++) {
+            if (unit_counts[i].load(std::memory_order_relaxed) != 0) {
+                resumed_units++;
+            }
+        }
+        done_units.store(resumed_units);
+        std::cout << "info string perft cache " << file_name << " has " << resumed_units << " of " << units.size()
+                  << " units done" << std::endl;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::atomic<size_t> next_unit = 0;
+        std::atomic<uint64_t> new_nodes = 0;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, root = board]() mutable {
+                PerftTest<Perft_TT> perft_test(table);
+                for (size_t unit = next_unit++; unit < units.size(); unit = next_unit++) {
+                    if (unit_counts[unit].load(std::memory_order_relaxed) != 0) {
+                        continue;
+                    }
+                    for (Move move : units[unit]) {
+                        root.makeMove(move);
+                    }
+                    uint64_t nodes = perft_test.hash_perft(root, depth - split_depth);
+                    for (auto it = units[unit].rbegin(); it != units[unit].rend(); it++) {
+                        root.unmakeMove(*it);
+                    }
+                    unit_counts[unit].store(nodes + 1, std::memory_order_release);
+                    new_nodes += nodes;
+                    done_units++;
+                }
+            });
+        }
+
+        auto last_checkpoint = start;
+        while (done_units < units.size()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto now = std::chrono::high_resolution_clock::now();
+            if (std::chrono::duration<double>(now - last_checkpoint).count() >= checkpoint_seconds) {
+                msync(mapping, mapping_size, MS_SYNC);
+                last_checkpoint = now;
+                std::chrono::duration<double> elapsed = now - start;
+                std::cout << "info string perft checkpoint units " << done_units << " of " << units.size() << " nodes "
+                          << new_nodes << " time " << elapsed.count() << " nps "
+                          << (uint64_t) (new_nodes / elapsed.count()) << std::endl;
+            }
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+
+        uint64_t total_nodes = 0;
+        for (size_t i = 0; i < units.size(); i++) {
+            total_nodes += unit_counts[i].load(std::memory_order_acquire) - 1;
+        }
+        std::cout << "info string perft depth " << depth << " nodes " << total_nodes << " resumed units "
+                  << resumed_units << " of " << units.size() << " time " << duration.count() << " nps "
+                  << (uint64_t) (new_nodes / (duration.count() + 1e-9)) << " (new nodes only)" << std::endl;
+        close_file();
+        return total_nodes;
+    }
+
+    /**
+     * The start position check from PerftTest, for the depths that don't fit into one run.
+     */
+    static void start_pos_perft(const std::string& file_name, int depth, size_t num_threads,
+                                uint64_t table_size_in_mb = 1024) {
+        Persistent_Perft persistent_perft(file_name, table_size_in_mb);
+        Board board = Board(DEFAULT_POS);
+        uint64_t nodes = persistent_perft.perft(board, depth, num_threads);
+        if (depth < (int) std::size(START_POS_PERFT_RESULTS) && nodes != START_POS_PERFT_RESULTS[depth]) {
+            std::cout << "Wrong node count at depth " << depth << ": " << nodes << " instead of "
+                      << START_POS_PERFT_RESULTS[depth] << std::endl;
+        }
+    }
+};
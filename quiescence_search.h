@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+#include "attack_tables.h"
+
+constexpr int Q_SEARCH_TT_DEPTH = 0; // Main search nodes always have depth >= 1, so q-nodes get this TT slot to themselves
+constexpr Eval_Type DELTA_MARGIN = 200;
+
+/**
+ * Delta and SEE pruning assume the eval is mostly material, for the random eval modes they would only cut random parts
+ * of the tree.
+ */
+constexpr bool material_pruning_enabled(Board::Eval_Mode mode) {
+    return USE_ACCUMULATOR || mode == Board::Full_PST || mode == Board::Incremental_PST;
+}
+
+constexpr bool Q_SEARCH_TT = true;
+constexpr bool DELTA_PRUNING = material_pruning_enabled(Board::EVAL_MODE);
+constexpr bool SEE_PRUNING = material_pruning_enabled(Board::EVAL_MODE);
+
+constexpr int SEE_VALUES[13] = { 100, 320, 330, 500, 900, 10000, 100, 320, 330, 500, 900, 10000, 0 };
+
+/**
+ * The captured piece. En passant captures go to an empty square but still capture a pawn.
+ */
+inline int captured_value(Board& board, Move move) {
+    Piece victim = board.board[to(move)];
+    return victim == None ? SEE_VALUES[WhitePawn] : SEE_VALUES[victim];
+}
+
+inline bool is_promotion(Board& board, Move move) {
+    Piece moving = board.board[from(move)];
+    int rank = to(move) / 8;
+    return (moving == WhitePawn && rank == 7) || (moving == BlackPawn && rank == 0);
+}
+
+/**
+ * Most valuable victim first, for equal victims the least valuable attacker first.
+ */
+inline void score_captures(Board& board, Movelist& captures) {
+    for (auto& capture : captures) {
+        capture.value = captured_value(board, capture.move) * 8 - board.board[from(capture.move)] % 6;
+    }
+}
+
+/**
+ * Even winning the captured piece plus a margin does not get the stand pat eval up to alpha. Promotions are never
+ * pruned since the captured piece is not where their value is.
+ */
+inline bool delta_prune(Board& board, Move move, Eval_Type stand_pat, Eval_Type alpha) {
+    return stand_pat + captured_value(board, move) + DELTA_MARGIN <= alpha && !is_promotion(board, move);
+}
+
+/**
+ * What a delta pruned capture could still have been worth, at most alpha. Skipping it makes the node's fail low value
+ * depend on alpha, so the value returned and stored as an upper bound must not be lower than this, or a later probe
+ * with a lower alpha would cut on a bound that is too low.
+ */
+inline Eval_Type delta_prune_bound(Board& board, Move move, Eval_Type stand_pat) {
+    return (Eval_Type) (stand_pat + captured_value(board, move) + DELTA_MARGIN);
+}
+
+inline uint64_t attackers_to(Board& board, int square, uint64_t occupied) {
+    const uint64_t* pieces = board.piecesBB;
+    uint64_t bishops = pieces[WhiteBishop] | pieces[BlackBishop] | pieces[WhiteQueen] | pieces[BlackQueen];
+    uint64_t rooks = pieces[WhiteRook] | pieces[BlackRook] | pieces[WhiteQueen] | pieces[BlackQueen];
+    return ((attack_tables.pawn(Black, square) & pieces[WhitePawn]) // I.e. white pawns a black pawn here would attack
+            | (attack_tables.pawn(White, square) & pieces[BlackPawn])
+            | (attack_tables.knight(square) & (pieces[WhiteKnight] | pieces[BlackKnight]))
+            | (attack_tables.king(square) & (pieces[WhiteKing] | pieces[BlackKing]))
+            | (attack_tables.bishop(square, occupied) & bishops)
+            | (attack_tables.rook(square, occupied) & rooks)) & occupied;
+}
+
+/**
+ * Static exchange evaluation of a capture with the usual swap algorithm: both sides keep recapturing on the target
+ * square with their least valuable attacker, and either side may stop whenever continuing would lose material.
+ * X-rays are handled by recomputing the slider attacks with the captured pieces removed from the occupancy.
+ * Pins and promotions are ignored.
+ * @return The material balance of the exchange for the side to move, in centipawns.
+ */
+inline int static_exchange_evaluation(Board& board, Move move) {
+    uint64_t occupied = 0;
+    for (uint64_t pieces : board.piecesBB) {
+        occupied |= pieces;
+    }
+    int square = to(move);
+    int gain[32];
+    int exchanges = 0;
+    gain[0] = captured_value(board, move);
+    Piece on_square = board.board[from(move)];
+    occupied ^= 1ULL << from(move);
+    int side = board.sideToMove == White ? Black : White;
+
+    while (exchanges < 31) {
+        uint64_t attackers = attackers_to(board, square, occupied);
+        int first = side == White ? WhitePawn : BlackPawn;
+        int attacker = first;
+        while (attacker < first + 6 && (attackers & board.piecesBB[attacker]) == 0) { // Least valuable attacker
+            attacker++;
+        }
+        if (attacker == first + 6) {
+            break;
+        }
+        exchanges++;
+        gain[exchanges] = SEE_VALUES[on_square] - gain[exchanges - 1];
+        if (std::max(-gain[exchanges - 1], gain[exchanges]) < 0) { // Neither side can improve by continuing
+            break;
+        }
+        uint64_t attacker_pieces = attackers & board.piecesBB[attacker];
+        occupied ^= attacker_pieces & -attacker_pieces;
+        on_square = (Piece) attacker;
+        side = side == White ? Black : White;
+    }
+    while (exchanges > 0) {
+        gain[exchanges - 1] = -std::max(-gain[exchanges - 1], gain[exchanges]);
+        exchanges--;
+    }
+    return gain[0];
+}
+
+/**
+ * Capturing a cheaper piece with a more expensive one loses material if the exchange goes badly. All other captures
+ * win material or at least trade evenly, so the SEE itself only runs for the former.
+ */
+inline bool see_prune(Board& board, Move move) {
+    if (SEE_VALUES[board.board[from(move)]] <= captured_value(board, move)) {
+        return false;
+    }
+    return static_exchange_evaluation(board, move) < 0;
+}
+
+/**
+ * Per-thread q-search counters.
+ */
+struct Q_Search_Stats {
+    uint64_t tt_probes = 0, tt_hits = 0, tt_cutoffs = 0, tt_stores = 0;
+    uint64_t delta_prunes = 0, see_prunes = 0;
+
+    void add(const Q_Search_Stats& other) {
+        tt_probes += other.tt_probes;
+        tt_hits += other.tt_hits;
+        tt_cutoffs += other.tt_cutoffs;
+        tt_stores += other.tt_stores;
+        delta_prunes += other.delta_prunes;
+        see_prunes += other.see_prunes;
+    }
+
+    void print() const {
+        std::cout << "Q-search TT probes: " << tt_probes << ", hits: " << tt_hits << ", cutoffs: " << tt_cutoffs
+                  << ", stores: " << tt_stores << ", delta prunes: " << delta_prunes << ", SEE prunes: " << see_prunes
+                  << std::endl;
+    }
+};
+
+/**
+ * Sums up the q-search counters of all search threads and prints them.
+ */
+template<class Searcher>
+void print_q_search_stats(const std::vector<Searcher>& searchers) {
+    Q_Search_Stats total;
+    for (const Searcher& searcher : searchers) {
+        total.add(searcher.get_q_search_stats());
+    }
+    total.print();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include "chess.hpp"
+#include "move_picker.h"
+#include "move_ordering.h"
+#include "selective_search.h"
+#include "quiescence_search.h"
+#include "multipv.h"
+
+/**
+ * The node helpers all searchers share, as a CRTP base. Searcher is the searcher itself; it has to befriend this class,
+ * since the helpers work on its board, move ordering and stats, and call back into its searches. The TTs
+ * differ in their interface, so the searcher reads and writes the q-search slot with q_tt_get and q_tt_put, on entries
+ * of type TT_Entry.
+ */
+template<class Searcher, class TT_Entry, bool MOVE_ORDERING, bool SELECTIVE>
+class Search_Base {
+
+protected:
+    inline Searcher& self() {
+        return static_cast<Searcher&>(*this);
+    }
+
+    /**
+     * Should be called for the move that produced a beta cutoff, after it has been unmade.
+     */
+    inline void beta_cutoff(Move move, int depth) {
+        if constexpr (MOVE_ORDERING) {
+            self().move_ordering.update(self().board, move, depth);
+        }
+    }
+
+    /**
+     * Like tt_probe, but for the q-search slot of the TT. There is no shallower entry to fall back on for the move.
+     */
+    bool q_tt_probe(Move& move, Eval_Type& alpha, Eval_Type& beta) {
+        if constexpr (!Q_SEARCH_TT) {
+            return false;
+        }
+        Q_Search_Stats& q_search_stats = self().q_search_stats;
+        q_search_stats.tt_probes++;
+        TT_Entry tt_entry{};
+        if (self().q_tt_get(tt_entry)) {
+            q_search_stats.tt_hits++;
+            if (tt_entry.type == EXACT) {
+                alpha = tt_entry.eval;
+                q_search_stats.tt_cutoffs++;
+                return true;
+            }
+            if (tt_entry.type == UPPER_BOUND) {
+                beta = std::min(beta, tt_entry.eval);
+            } else if (tt_entry.type == LOWER_BOUND) {
+                alpha = std::max(alpha, tt_entry.eval);
+            }
+
+            if (alpha >= beta) { // Our window is empty due to the TT hit
+                alpha = tt_entry.eval;
+                q_search_stats.tt_cutoffs++;
+                return true;
+            }
+            move = tt_entry.move;
+        }
+        return false;
+    }
+
+    inline void q_tt_store(TT_Entry& entry, Eval_Type q_eval) {
+        if constexpr (Q_SEARCH_TT) {
+            entry.eval = q_eval;
+            self().q_tt_put(entry);
+            self().q_search_stats.tt_stores++;
+        }
+    }
+
+    /**
+     * The TT move first, then the captures by MVV-LVA.
+     */
+    inline Move next_capture(Staged_Move_Picker& picker) {
+        return picker.next<true>([this](Movelist& captures) {
+            Movegen::legalmoves<CAPTURE>(self().board, captures);
+            score_captures(self().board, captures);
+        });
+    }
+
+    /**
+     * A delta pruned capture raises q_eval to what it could have been worth, see delta_prune_bound.
+     */
+    inline bool prune_capture(Move capture, Eval_Type stand_pat, Eval_Type alpha, Eval_Type& q_eval) {
+        Board& board = self().board;
+        if constexpr (DELTA_PRUNING) {
+            if (delta_prune(board, capture, stand_pat, alpha)) {
+                q_eval = std::max(q_eval, delta_prune_bound(board, capture, stand_pat));
+                self().q_search_stats.delta_prunes++;
+                return true;
+            }
+        }
+        if constexpr (SEE_PRUNING) {
+            if (see_prune(board, capture)) {
+                self().q_search_stats.see_prunes++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void make_null_move() {
+        if constexpr (MOVE_ORDERING) {
+            self().move_ordering.push(self().board, NO_MOVE);
+        }
+        self().board.makeNullMove();
+    }
+
+    inline void unmake_null_move() {
+        self().board.unmakeNullMove();
+        if constexpr (MOVE_ORDERING) {
+            self().move_ordering.pop();
+        }
+    }
+
+    /**
+     * The reduction of the move that was just made, always zero outside of selective mode. Captures, checks, moves out
+     * of check and the first few moves of a node are never reduced.
+     */
+    inline int late_move_reduction(int depth, int move_count, bool quiet, bool in_check) {
+        if constexpr (SELECTIVE) {
+            if (depth >= LMR_MIN_DEPTH && move_count >= LMR_MIN_MOVES && quiet && !in_check
+                && !self().board.in_check()) {
+                return std::min(late_move_reductions.at(depth, move_count), depth - 2); // Not into the q-search
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Null window search of the position after a late move. If the reduced search fails high, the move is refuted and
+     * we are done, otherwise it might be better than expected, so it gets re-searched to full depth.
+     */
+    inline Eval_Type late_move_search(Eval_Type beta, int depth, int reduction) {
+        if constexpr (SELECTIVE) {
+            if (reduction > 0) {
+                self().selective_stats.reductions[depth + 1]++;
+                Eval_Type eval = self().null_window_search(beta, depth - reduction);
+                if (eval >= beta) {
+                    return eval;
+                }
+                self().selective_stats.re_searches[depth + 1]++;
+            }
+        }
+        return self().null_window_search(beta, depth);
+    }
+
+public:
+    /**
+     * Searches the root moves handed out by root_moves, each with the K-th best score so far as alpha, so that the best
+     * K of them end up with exact scores.
+     */
+    template<bool PV_Search>
+    void multipv_root_max(Root_Moves& root_moves, int depth) {
+        Searcher& searcher = self();
+        size_t index;
+        while (root_moves.next_move(index)) {
+            Move move = root_moves.move(index);
+            Eval_Type alpha = root_moves.current_alpha();
+            searcher.make_move(move);
+            Eval_Type inner_eval;
+            if (depth == 1) {
+                inner_eval = -searcher.q_search(-FULL_WINDOW_BETA, -alpha);
+            } else if constexpr (!PV_Search) {
+                inner_eval = -searcher.nega_max(-FULL_WINDOW_BETA, -alpha, depth - 1);
+            } else if (alpha == FULL_WINDOW_ALPHA
+                       || (inner_eval = -searcher.null_window_search(-alpha, depth - 1)) > alpha) {
+                inner_eval = -searcher.pv_search(-FULL_WINDOW_BETA, -alpha, depth - 1);
+            }
+            searcher.unmake_move(move);
+            root_moves.report(index, inner_eval);
+        }
+    }
+
+    /**
+     * The same for a helper thread, which adds its nodes to the shared count when done.
+     */
+    template<bool PV_Search>
+    void multipv_root_max(Root_Moves& root_moves, int depth, std::atomic<uint64_t>& total_node_count) {
+        self().nodes = 0;
+        multipv_root_max<PV_Search>(root_moves, depth);
+        total_node_count += self().nodes;
+    }
+};
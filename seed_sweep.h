@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "chess.hpp"
+#include "sequential_search.h"
+
+/**
+ * One search of the sweep, as written to the binary output file.
+ */
+#pragma pack(push, 1)
+struct Sweep_Record {
+    uint64_t seed;
+    uint32_t position;
+    uint16_t move;
+    int16_t eval;
+    uint64_t nodes;
+    double duration;
+};
+#pragma pack(pop)
+
+/**
+ * Runs a search for every combination of seed and position. The positions of one seed get spread over a pool of
+ * workers, each with its own TT, which only gets cleared when the seed changes; the eval, and with it every TT entry,
+ * only depends on the seed, so the positions of a seed can share it. The seed is the global one from chess.hpp, which
+ * is why the seeds run one after another and only the positions in parallel.
+ * Every result gets streamed to the output file as soon as it is there, as CSV or, if the file name ends in .bin, as
+ * packed Sweep_Records. At the end, the move frequencies per position over all seeds go to a second CSV file.
+ */
+template<bool Q_SEARCH, TT_Strategy strategy>
+class Seed_Sweep {
+
+    std::vector<std::string> positions;
+    size_t num_workers;
+    std::deque<Transposition_Table<strategy>> tables; // One per worker, a deque since the tables can't be moved
+    std::ofstream output;
+    bool binary;
+    std::mutex output_lock;
+    std::vector<std::map<std::string, uint64_t>> move_frequencies;
+
+    template<class Search_Result>
+    Search_Result search_position(const std::string& fen, int depth, Transposition_Table<strategy>& table) {
+        Board board;
+        board.applyFen(fen);
+        Search<Q_SEARCH, strategy> search(board, table);
+        Search_Result result;
+        uint64_t nodes = 0;
+        double duration = 0;
+        for (int current_depth = 1; current_depth <= depth; current_depth++) {
+            search.template aspiration_root_max<Search_Result, true>(result.eval, current_depth, result);
+            nodes += result.nodes;
+            duration += result.duration;
+        }
+        result.nodes = nodes;
+        result.duration = duration;
+        return result;
+    }
+
+    template<class Search_Result>
+    void write(uint32_t position, const Search_Result& result) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        move_frequencies[position][convertMoveToUci(result.move)]++;
+        if (binary) {
+            Sweep_Record record{seed, position, (uint16_t) result.move, result.eval, result.nodes, result.duration};
+            output.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        } else {
+            output << seed << "," << position << "," << convertMoveToUci(result.move) << "," << result.eval << ","
+                   << result.nodes << "," << result.duration << "\n";
+        }
+    }
+
+    void write_move_frequencies(const std::string& file_name, uint64_t num_seeds) {
+        std::ofstream frequencies(file_name);
+        frequencies << "position,move,count,frequency\n";
+        for (size_t position = 0; position < positions.size(); position++) {
+            for (const auto& [move, count] : move_frequencies[position]) {
+                frequencies << position << "," << move << "," << count << "," << (double) count / num_seeds << "\n";
+            }
+        }
+    }
+
+public:
+    /**
+     * @param table_size_in_mb Per worker, must be a power of two like for all tables.
+     */
+    Seed_Sweep(std::vector<std::string> positions, size_t num_workers, uint64_t table_size_in_mb,
+               const std::string& output_file)
+            : positions(std::move(positions)), num_workers(std::max<size_t>(num_workers, 1)),
+              output(output_file, std::ios::binary), binary(output_file.ends_with(".bin")),
+              move_frequencies(this->positions.size()) {
+        for (size_t i = 0; i < this->num_workers; i++) {
+            tables.emplace_back(table_size_in_mb);
+        }
+        if (!binary) {
+            output << "seed,position,move,eval,nodes,time\n";
+        }
+        if constexpr (Board::EVAL_MODE != Board::Pseudo_random) {
+            std::cout << "info string seed sweep without the pseudo random eval, the seeds make no difference" << std::endl;
+        }
+    }
+
+    /**
+     * Sweeps the seeds first_seed, first_seed + 1, ... and restores the seed afterwards.
+     */
+    template<class Search_Result>
+    void run(uint64_t first_seed, uint64_t num_seeds, int depth, const std::string& frequency_file) {
+        uint64_t previous_seed = seed;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::atomic<uint64_t> total_nodes = 0;
+        for (uint64_t i = 0; i < num_seeds; i++) {
+            seed = first_seed + i; // No worker is running here, so this is safe
+            std::atomic<size_t> next_position = 0;
+            std::vector<std::thread> workers;
+            for (auto& table : tables) {
+                table.clear();
+                workers.emplace_back([&, &table = table] {
+                    for (size_t position = next_position++; position < positions.size(); position = next_position++) {
+                        auto result = search_position<Search_Result>(positions[position], depth, table);
+                        total_nodes += result.nodes;
+                        write((uint32_t) position, result);
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+        output.flush();
+        write_move_frequencies(frequency_file, num_seeds);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+        seed = previous_seed;
+
+        std::cout << "info string seed sweep seeds " << num_seeds << " positions " << positions.size() << " depth "
+                  << depth << " workers " << num_workers << " nodes " << total_nodes << " time " << duration.count()
+                  << " nps " << (uint64_t) (total_nodes / duration.count()) << std::endl;
+    }
+};
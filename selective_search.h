@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include "chess.hpp"
+#include "compile_time_constants.h"
+
+constexpr int NULL_MOVE_MIN_DEPTH = 3;
+constexpr int LMR_MIN_DEPTH = 3;
+constexpr int LMR_MIN_MOVES = 4; // The TT move, and usually the killers, are never reduced
+
+/**
+ * Null move reduction R, the null move gets searched to depth - 1 - R.
+ */
+inline int null_move_reduction(int depth) {
+    return 2 + depth / 4;
+}
+
+/**
+ * Zugzwang guard for null move pruning: if the side to move only has pawns (and the king) left, passing is often
+ * better than any real move, so a null move proves nothing.
+ */
+inline bool has_non_pawn_material(Board& board) {
+    int offset = board.sideToMove == White ? 0 : BlackPawn;
+    return (board.piecesBB[WhiteKnight + offset] | board.piecesBB[WhiteBishop + offset]
+            | board.piecesBB[WhiteRook + offset] | board.piecesBB[WhiteQueen + offset]) != 0;
+}
+
+/**
+ * The usual logarithmic late move reductions, precomputed by depth and move number.
+ */
+class Late_Move_Reductions {
+
+public:
+    Late_Move_Reductions() {
+        for (int depth = 1; depth < MAX_SEARCH_DEPTH; depth++) {
+            for (int move_count = 1; move_count < MAX_MOVE_COUNT; move_count++) {
+                table[depth][move_count] = (int8_t) (0.75 + std::log(depth) * std::log(move_count) / 2.25);
+            }
+        }
+    }
+
+    [[nodiscard]] inline int at(int depth, int move_count) const {
+        return table[depth][std::min(move_count, MAX_MOVE_COUNT - 1)];
+    }
+
+private:
+    static constexpr int MAX_MOVE_COUNT = 64;
+    int8_t table[MAX_SEARCH_DEPTH][MAX_MOVE_COUNT]{};
+};
+
+const Late_Move_Reductions late_move_reductions;
+
+/**
+ * Per-thread counters for the selective search, by the depth of the node where the pruning or reduction happened.
+ */
+struct Selective_Stats {
+    uint64_t null_move_prunes[MAX_SEARCH_DEPTH]{};
+    uint64_t reductions[MAX_SEARCH_DEPTH]{};
+    uint64_t re_searches[MAX_SEARCH_DEPTH]{};
+
+    void add(const Selective_Stats& other) {
+        for (int depth = 0; depth < MAX_SEARCH_DEPTH; depth++) {
+            null_move_prunes[depth] += other.null_move_prunes[depth];
+            reductions[depth] += other.reductions[depth];
+            re_searches[depth] += other.re_searches[depth];
+        }
+    }
+
+    void print(int up_to_depth) const {
+        std::cout << "depth\tnull move prunes\treductions\tre-searches" << std::endl;
+        for (int depth = 1; depth <= up_to_depth && depth < MAX_SEARCH_DEPTH; depth++) {
+            std::cout << depth << "\t" << null_move_prunes[depth] << "\t" << reductions[depth] << "\t"
+                      << re_searches[depth] << std::endl;
+        }
+    }
+};
+
+/**
+ * Sums up the selective search counters of all search threads and prints them per depth.
+ */
+template<class Searcher>
+void print_selective_stats(const std::vector<Searcher>& searchers, int up_to_depth) {
+    Selective_Stats total;
+    for (const Searcher& searcher : searchers) {
+        total.add(searcher.get_selective_stats());
+    }
+    total.print(up_to_depth);
+}
@@ -2,13 +2,36 @@
 
 #include "chess.hpp"
 #include "transposition_table.h"
-
-template<bool Q_SEARCH, TT_Strategy strategy>
-class Search {
+#include "accumulator.h"
+#include "eval_cache.h"
+#include "move_picker.h"
+#include "move_ordering.h"
+#include "selective_search.h"
+#include "search_base.h"
+#include "quiescence_search.h"
+#include "aspiration.h"
+#include "multipv.h"
+#include "mtdf.h"
+
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
+class Search
+        : public Search_Base<Search<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>, TT_Info, MOVE_ORDERING, SELECTIVE> {
 
 private:
+    using Base = Search_Base<Search, TT_Info, MOVE_ORDERING, SELECTIVE>;
+    friend Base;
+    using Base::beta_cutoff, Base::make_null_move, Base::unmake_null_move, Base::late_move_reduction,
+            Base::late_move_search, Base::q_tt_probe, Base::q_tt_store, Base::next_capture, Base::prune_capture;
+
     Board board;
     uint64_t nodes = 0;
+    Accumulator_Stack accumulators;
+    Eval_Cache eval_cache;
+    Move_Ordering move_ordering;
+    Selective_Stats selective_stats;
+    Aspiration_Stats aspiration_stats;
+    MTDF_Stats mtdf_stats;
+    Q_Search_Stats q_search_stats;
     Transposition_Table<strategy>& tt;
 
     /**
@@ -49,12 +72,93 @@ private:
         return false;
     }
 
+    inline Move next_move(Staged_Move_Picker& picker) {
+        return picker.next<MOVE_ORDERING>([this](Movelist& moves) {
+            Movegen::legalmoves<ALL>(board, moves);
+            if constexpr (MOVE_ORDERING) {
+                move_ordering.score(board, moves);
+            }
+        });
+    }
+
+    inline void make_move(Move move) {
+        if constexpr (MOVE_ORDERING) {
+            move_ordering.push(board, move);
+        }
+        if constexpr (USE_ACCUMULATOR) {
+            accumulators.make_move(board, move);
+        } else {
+            board.makeMove(move);
+        }
+    }
+
+    inline void unmake_move(Move move) {
+        if constexpr (USE_ACCUMULATOR) {
+            accumulators.unmake_move(board, move);
+        } else {
+            board.unmakeMove(move);
+        }
+        if constexpr (MOVE_ORDERING) {
+            move_ordering.pop();
+        }
+    }
+
+    /**
+     * The q-search slot of the TT, for q_tt_probe and q_tt_store of the base.
+     */
+    inline bool q_tt_get(TT_Info& entry) {
+        return tt.get_if_exists(board.hashKey, Q_SEARCH_TT_DEPTH, entry);
+    }
+
+    inline void q_tt_put(TT_Info& entry) {
+        tt.emplace(board.hashKey, entry, Q_SEARCH_TT_DEPTH);
+    }
+
+    inline Eval_Type evaluate() {
+        Eval_Type eval;
+        if constexpr (Eval_Cache::ENABLED) {
+            if (eval_cache.probe(board.hashKey, eval)) {
+                return eval;
+            }
+        }
+        if constexpr (USE_ACCUMULATOR) {
+            eval = accumulators.evaluate(board);
+        } else {
+            eval = board.eval();
+        }
+        if constexpr (Eval_Cache::ENABLED) {
+            eval_cache.store(board.hashKey, eval);
+        }
+        return eval;
+    }
+
 public:
     explicit Search(Board& board, Transposition_Table<strategy>& table) : board(board), tt(table) {
+        accumulators.refresh(this->board);
+    }
+
+    [[nodiscard]] const Eval_Cache& get_eval_cache() const {
+        return eval_cache;
+    }
+
+    [[nodiscard]] const Selective_Stats& get_selective_stats() const {
+        return selective_stats;
+    }
+
+    [[nodiscard]] const Q_Search_Stats& get_q_search_stats() const {
+        return q_search_stats;
+    }
+
+    [[nodiscard]] const Aspiration_Stats& get_aspiration_stats() const {
+        return aspiration_stats;
+    }
+
+    [[nodiscard]] const MTDF_Stats& get_mtdf_stats() const {
+        return mtdf_stats;
     }
 
     Eval_Type q_search(Eval_Type alpha, Eval_Type beta) {
-        Eval_Type q_eval = board.eval();
+        Eval_Type q_eval = evaluate();
         if (q_eval < MIN_EVAL) { // Avoid overflow issues when inverting the eval.
             q_eval = MIN_EVAL;
         }
@@ -63,35 +167,56 @@ public:
             return q_eval;
         }
 
-        if (q_eval >= beta) {
+        if (q_eval >= beta) { // Stand pat, checked before the TT probe since this is where most q-nodes end
             return q_eval;
         }
+        Move tt_move = NO_MOVE;
+        if (q_tt_probe(tt_move, alpha, beta)) { // I.e. if cutoff
+            return alpha; // TT entry value is put here
+        }
+        if (q_eval >= beta) { // The TT probe might have lowered beta
+            return q_eval;
+        }
+
+        TT_Info entry{q_eval, tt_move, (int8_t) Q_SEARCH_TT_DEPTH, UPPER_BOUND};
         if (q_eval > alpha) {
             alpha = q_eval;
+            entry.type = EXACT;
         }
 
-        Movelist captures;
-        Movegen::legalmoves<CAPTURE>(board, captures);
-        for (auto& capture : captures) {
-            board.makeMove(capture.move);
+        Eval_Type stand_pat = q_eval;
+        int capture_count = 0;
+        Staged_Move_Picker picker(board, tt_move);
+        for (Move capture = next_capture(picker); capture != NO_MOVE; capture = next_capture(picker)) {
+            capture_count++;
+            if (prune_capture(capture, stand_pat, alpha, q_eval)) {
+                continue;
+            }
+            make_move(capture);
             Eval_Type inner_eval = -q_search(-beta, -alpha);
-            board.unmakeMove(capture.move);
+            unmake_move(capture);
             if (inner_eval > q_eval) {
                 q_eval = inner_eval;
+                entry.move = capture;
                 if (q_eval >= beta) {
+                    entry.type = LOWER_BOUND;
                     break;
                 }
                 if (q_eval > alpha) {
                     alpha = q_eval;
+                    entry.type = EXACT;
                 }
             }
         }
 
+        if (capture_count > 0) { // Without captures the entry would save nothing but the move generation
+            q_tt_store(entry, q_eval);
+        }
         return q_eval;
     }
 
     Eval_Type nw_q_search(Eval_Type beta) {
-        Eval_Type q_eval = board.eval();
+        Eval_Type q_eval = evaluate();
         if (q_eval < MIN_EVAL) { // Avoid overflow issues when inverting the eval.
             q_eval = MIN_EVAL;
         }
@@ -100,28 +225,44 @@ public:
             return q_eval;
         }
 
-        if (q_eval >= beta) {
+        if (q_eval >= beta) { // Stand pat, checked before the TT probe since this is where most q-nodes end
             return q_eval;
         }
+        Move tt_move = NO_MOVE;
+        Eval_Type alpha = beta - 1;
+        if (q_tt_probe(tt_move, alpha, beta)) { // I.e. if cutoff
+            return alpha; // TT entry value is put here
+        }
 
-        Movelist captures;
-        Movegen::legalmoves<CAPTURE>(board, captures);
-        for (auto& capture : captures) {
-            board.makeMove(capture.move);
+        TT_Info entry{q_eval, tt_move, (int8_t) Q_SEARCH_TT_DEPTH, UPPER_BOUND};
+        Eval_Type stand_pat = q_eval;
+        int capture_count = 0;
+        Staged_Move_Picker picker(board, tt_move);
+        for (Move capture = next_capture(picker); capture != NO_MOVE; capture = next_capture(picker)) {
+            capture_count++;
+            if (prune_capture(capture, stand_pat, alpha, q_eval)) {
+                continue;
+            }
+            make_move(capture);
             Eval_Type inner_eval = -nw_q_search(-beta + 1);
-            board.unmakeMove(capture.move);
+            unmake_move(capture);
             if (inner_eval > q_eval) {
                 q_eval = inner_eval;
+                entry.move = capture;
                 if (q_eval >= beta) {
+                    entry.type = LOWER_BOUND;
                     break;
                 }
             }
         }
 
+        if (capture_count > 0) { // Without captures the entry would save nothing but the move generation
+            q_tt_store(entry, q_eval);
+        }
         return q_eval;
     }
 
-    Eval_Type null_window_search(Eval_Type beta, int depth) {
+    Eval_Type null_window_search(Eval_Type beta, int depth, bool allow_null_move = true) {
         Eval_Type eval = MIN_EVAL - MAX_MATE_DEPTH;
         Move tt_move = NO_MOVE;
         Eval_Type alpha = beta - 1;
@@ -130,38 +271,55 @@ public:
         }
 
         TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        Movegen::legalmoves<ALL>(board, moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE[depth % 2];
+        if constexpr (SELECTIVE) {
+            if (allow_null_move && depth >= NULL_MOVE_MIN_DEPTH && !board.in_check() && has_non_pawn_material(board)
+                && evaluate() >= beta) {
+                int null_move_depth = depth - 1 - null_move_reduction(depth);
+                make_null_move();
+                Eval_Type null_move_eval = null_move_depth > 0 ? -null_window_search(-beta + 1, null_move_depth, false)
+                                                               : -nw_q_search(-beta + 1);
+                unmake_null_move();
+                if (null_move_eval >= beta) { // Even passing is good enough, so some real move most likely is too
+                    selective_stats.null_move_prunes[depth]++;
+                    entry.eval = null_move_eval > MAX_EVAL ? beta : null_move_eval; // Don't trust mate scores here
+                    entry.type = LOWER_BOUND;
+                    tt.emplace(board.hashKey, entry, depth);
+                    return entry.eval;
+                }
             }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
         }
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        bool in_check = SELECTIVE && board.in_check(); // Moves out of check are never reduced
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            bool quiet = board.board[to(move)] == None;
+            make_move(move);
+            int reduction = late_move_reduction(depth, move_count, quiet, in_check);
             Eval_Type inner_eval;
             if (depth > 1) {
-                inner_eval = -null_window_search(-beta + 1, depth - 1);
+                inner_eval = -late_move_search(-beta + 1, depth - 1, reduction);
             } else {
                 inner_eval = -nw_q_search(-beta + 1);
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move;
+                entry.move = move;
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -175,37 +333,31 @@ public:
         }
 
         TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        Movegen::legalmoves<ALL>(board, moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE[depth % 2];
-            }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
-        }
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        bool in_check = SELECTIVE && board.in_check(); // Moves out of check are never reduced
 
         bool search_full_window = true;
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            bool quiet = board.board[to(move)] == None;
+            make_move(move);
+            int reduction = late_move_reduction(depth, move_count, quiet, in_check);
             Eval_Type inner_eval;
             if (depth == 1) {
                 inner_eval = -q_search(-beta, -alpha);
-            } else if (search_full_window || (inner_eval = -null_window_search(-alpha, depth - 1)) > alpha){
+            } else if (search_full_window || (inner_eval = -late_move_search(-alpha, depth - 1, reduction)) > alpha){
                 inner_eval = -pv_search(-beta, -alpha, depth - 1);
                 search_full_window = false;
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move; // If it stays this way, this is the best move
+                entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -215,6 +367,12 @@ public:
 
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -228,30 +386,26 @@ public:
         }
 
         TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        Movegen::legalmoves<ALL>(board, moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE[depth % 2];
-            }
-            return eval;
-        }
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
 
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            make_move(move);
             Eval_Type inner_eval;
             if (depth > 1) {
                 inner_eval = -nega_max(-beta, -alpha, depth - 1);
             } else {
                 inner_eval = -q_search(-beta, -alpha);
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move; // If it stays this way, this is the best move
+                entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -261,6 +415,12 @@ public:
 
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -277,6 +437,7 @@ public:
             return Search_Result{0, 0, tt_move, alpha, (uint16_t) depth};
         }
 
+        Eval_Type root_alpha = alpha; // The window might not be the full one, so the result can be a bound
         Movelist moves;
         Movegen::legalmoves<ALL>(board, moves);
         int tt_move_index = moves.find(tt_move);
@@ -289,7 +450,7 @@ public:
         bool search_full_window = true;
         for (auto& move_container : moves) {
             auto move = move_container.move;
-            board.makeMove(move);
+            make_move(move);
             Eval_Type inner_eval;
             if (depth == 1) {
                 inner_eval = -q_search(-beta, -alpha);
@@ -305,7 +466,7 @@ public:
                 tt.print_pv(board, depth - 1);
                 tt.print_size();
             }
-            board.unmakeMove(move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
@@ -318,7 +479,7 @@ public:
                 }
             }
         }
-        tt.emplace(board.hashKey, {eval, best_move, (int8_t) depth, EXACT}, depth);
+        tt.emplace(board.hashKey, {eval, best_move, (int8_t) depth, root_bound_type(eval, root_alpha, beta)}, depth);
 
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> duration = end - start;
@@ -329,4 +490,80 @@ public:
         result.depth = depth;
         return result;
     }
+
+    /**
+     * Root search with an aspiration window around the score of the previous iteration, repeated with a wider window
+     * until the score lies inside of it. Nodes and time of all attempts are added up in the result.
+     */
+    template<class Search_Result, bool PV_Search>
+    Search_Result aspiration_root_max(Eval_Type previous_eval, int depth, Search_Result& result) {
+        Aspiration_Window window(previous_eval, depth);
+        uint64_t total_nodes = 0;
+        double total_duration = 0;
+        do {
+            result = root_max<Search_Result, PV_Search>(window.alpha, window.beta, depth, result);
+            total_nodes += result.nodes;
+            total_duration += result.duration;
+        } while (window.widen(result.eval, aspiration_stats));
+        result.nodes = total_nodes;
+        result.duration = total_duration;
+        return result;
+    }
+
+    /**
+     * MTD(f): converges on the root score with null window searches only, starting from a guess, usually the score of
+     * the previous iteration. Every probe stores its bound in the TT, so repeated probes mostly walk the tree through
+     * TT hits.
+     */
+    template<class Search_Result>
+    Search_Result mtdf(Eval_Type guess, int depth, Search_Result& result) {
+        auto start = std::chrono::high_resolution_clock::now();
+        nodes = 0;
+        assert(depth > 0);
+        MTDF_Window window(guess);
+        Eval_Type beta;
+        while (window.next_beta(0, 1, beta)) {
+            Eval_Type eval = null_window_search(beta, depth, false); // A null move at the root would leave us without a move
+            TT_Info entry{};
+            bool found = tt.get_if_exists(board.hashKey, depth, entry); // After a fail high this has the best move
+            window.update(beta, eval, found ? entry.move : NO_MOVE);
+        }
+        mtdf_stats.probes[depth] += window.probe_count();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+        result.nodes = nodes;
+        result.duration = duration.count();
+        result.move = window.move();
+        result.eval = window.value();
+        result.depth = depth;
+        return result;
+    }
+
+    /**
+     * Iterative deepening where the best multi_pv root moves all get exact scores. The root moves get reordered by
+     * their scores between iterations.
+     */
+    template<class Search_Result, bool PV_Search>
+    Search_Result multipv_search(int up_to_depth, size_t multi_pv) {
+        Search_Result result;
+        Root_Moves root_moves(board, multi_pv);
+        for (int depth = 1; depth <= up_to_depth && root_moves.size() > 0; depth++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            nodes = 0;
+            root_moves.start_iteration();
+            this->template multipv_root_max<PV_Search>(root_moves, depth);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+
+            Root_Move best = root_moves.best()[0];
+            result.move = best.move;
+            result.eval = best.score;
+            result.depth = depth;
+            result.duration = duration.count();
+            result.nodes = nodes;
+            root_moves.print(board, tt, depth, result.nodes, result.duration);
+        }
+        return result;
+    }
 };
\ No newline at end of file
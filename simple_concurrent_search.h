@@ -3,16 +3,39 @@
 #include <thread>
 #include <functional>
 #include "locking_tt.h"
-
-
-template<bool Q_SEARCH, TT_Strategy strategy>
-class alignas (128) Search_Thread { // Let's go big with the alignas just in case
+#include "accumulator.h"
+#include "eval_cache.h"
+#include "move_picker.h"
+#include "move_ordering.h"
+#include "selective_search.h"
+#include "search_base.h"
+#include "quiescence_search.h"
+#include "aspiration.h"
+#include "multipv.h"
+#include "mtdf.h"
+
+
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
+class alignas (128) Search_Thread // Let's go big with the alignas just in case
+        : public Search_Base<Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>, Locked_TT_Info, MOVE_ORDERING,
+                             SELECTIVE> {
 
 private:
+    using Base = Search_Base<Search_Thread, Locked_TT_Info, MOVE_ORDERING, SELECTIVE>;
+    friend Base;
+    using Base::beta_cutoff, Base::make_null_move, Base::unmake_null_move, Base::late_move_reduction,
+            Base::late_move_search, Base::q_tt_probe, Base::q_tt_store, Base::next_capture, Base::prune_capture;
+
     Board board;
     uint64_t nodes = 0;
+    Accumulator_Stack accumulators;
+    Eval_Cache eval_cache;
+    Move_Ordering move_ordering;
+    Selective_Stats selective_stats;
+    Q_Search_Stats q_search_stats;
     Locking_TT<strategy>& tt;
     std::atomic<bool>& finished;
+    Root_Moves* root_order = nullptr; // Set if the driver keeps the root move order across iterations
 
     /**
      *
@@ -52,6 +75,7 @@ private:
         return false;
     }
 
+public: // For the microbenchmarks
     template<Movetype TYPE>
     void generate_shuffled_moves(Movelist& moves) {
         Movegen::legalmoves<TYPE>(board, moves);
@@ -69,13 +93,97 @@ private:
         }
     }
 
+private:
+    inline Move next_move(Staged_Move_Picker& picker) {
+        return picker.next<MOVE_ORDERING>([this](Movelist& moves) {
+            generate_shuffled_moves<ALL>(moves);
+            if constexpr (MOVE_ORDERING) {
+                move_ordering.score(board, moves);
+            }
+        });
+    }
+
+    inline void make_move(Move move) {
+        if constexpr (MOVE_ORDERING) {
+            move_ordering.push(board, move);
+        }
+        if constexpr (USE_ACCUMULATOR) {
+            accumulators.make_move(board, move);
+        } else {
+            board.makeMove(move);
+        }
+    }
+
+    inline void unmake_move(Move move) {
+        if constexpr (USE_ACCUMULATOR) {
+            accumulators.unmake_move(board, move);
+        } else {
+            board.unmakeMove(move);
+        }
+        if constexpr (MOVE_ORDERING) {
+            move_ordering.pop();
+        }
+    }
+
+    /**
+     * The q-search slot of the TT, for q_tt_probe and q_tt_store of the base.
+     */
+    inline bool q_tt_get(Locked_TT_Info& entry) {
+        return tt.get_if_exists(board.hashKey, Q_SEARCH_TT_DEPTH, entry);
+    }
+
+    inline void q_tt_put(Locked_TT_Info& entry) {
+        tt.emplace(board.hashKey, entry, Q_SEARCH_TT_DEPTH);
+    }
+
+    inline void record_root_move(Move move, uint64_t subtree_nodes, Eval_Type eval) {
+        if (root_order != nullptr) {
+            root_order->record(move, subtree_nodes, eval);
+        }
+    }
+
+    inline Eval_Type evaluate() {
+        Eval_Type eval;
+        if constexpr (Eval_Cache::ENABLED) {
+            if (eval_cache.probe(board.hashKey, eval)) {
+                return eval;
+            }
+        }
+        if constexpr (USE_ACCUMULATOR) {
+            eval = accumulators.evaluate(board);
+        } else {
+            eval = board.eval();
+        }
+        if constexpr (Eval_Cache::ENABLED) {
+            eval_cache.store(board.hashKey, eval);
+        }
+        return eval;
+    }
+
 public:
     explicit Search_Thread(Board& board, Locking_TT<strategy>& table, std::atomic<bool>& finished)
                                     : board(board), tt(table), finished(finished) {
+        accumulators.refresh(this->board);
+    }
+
+    void set_root_order(Root_Moves* order) {
+        root_order = order;
+    }
+
+    [[nodiscard]] const Eval_Cache& get_eval_cache() const {
+        return eval_cache;
+    }
+
+    [[nodiscard]] const Selective_Stats& get_selective_stats() const {
+        return selective_stats;
+    }
+
+    [[nodiscard]] const Q_Search_Stats& get_q_search_stats() const {
+        return q_search_stats;
     }
 
     Eval_Type q_search(Eval_Type alpha, Eval_Type beta) {
-        Eval_Type q_eval = board.eval();
+        Eval_Type q_eval = evaluate();
         if (q_eval < MIN_EVAL) { // Avoid overflow issues when inverting the eval.
             q_eval = MIN_EVAL;
         }
@@ -84,26 +192,44 @@ public:
             return q_eval;
         }
 
-        if (q_eval >= beta) {
+        if (q_eval >= beta) { // Stand pat, checked before the TT probe since this is where most q-nodes end
+            return q_eval;
+        }
+        Move tt_move = NO_MOVE;
+        if (q_tt_probe(tt_move, alpha, beta)) { // I.e. if cutoff
+            return alpha; // TT entry value is put here
+        }
+        if (q_eval >= beta) { // The TT probe might have lowered beta
             return q_eval;
         }
+
+        Locked_TT_Info entry{q_eval, tt_move, (int8_t) Q_SEARCH_TT_DEPTH, UPPER_BOUND};
         if (q_eval > alpha) {
             alpha = q_eval;
+            entry.type = EXACT;
         }
 
-        Movelist captures;
-        Movegen::legalmoves<CAPTURE>(board, captures);
-        for (auto& capture : captures) {
-            board.makeMove(capture.move);
+        Eval_Type stand_pat = q_eval;
+        int capture_count = 0;
+        Staged_Move_Picker picker(board, tt_move);
+        for (Move capture = next_capture(picker); capture != NO_MOVE; capture = next_capture(picker)) {
+            capture_count++;
+            if (prune_capture(capture, stand_pat, alpha, q_eval)) {
+                continue;
+            }
+            make_move(capture);
             Eval_Type inner_eval = -q_search(-beta, -alpha);
-            board.unmakeMove(capture.move);
+            unmake_move(capture);
             if (inner_eval > q_eval) {
                 q_eval = inner_eval;
+                entry.move = capture;
                 if (q_eval >= beta) {
+                    entry.type = LOWER_BOUND;
                     break;
                 }
                 if (q_eval > alpha) {
                     alpha = q_eval;
+                    entry.type = EXACT;
                 }
             }
             if (finished) { // If someone else already completed the search there is no reason for us to continue
@@ -111,11 +237,14 @@ public:
             }
         }
 
+        if (capture_count > 0) { // Without captures the entry would save nothing but the move generation
+            q_tt_store(entry, q_eval);
+        }
         return q_eval;
     }
 
     Eval_Type nw_q_search(Eval_Type beta) {
-        Eval_Type q_eval = board.eval();
+        Eval_Type q_eval = evaluate();
         if (q_eval < MIN_EVAL) { // Avoid overflow issues when inverting the eval.
             q_eval = MIN_EVAL;
         }
@@ -124,19 +253,32 @@ public:
             return q_eval;
         }
 
-        if (q_eval >= beta) {
+        if (q_eval >= beta) { // Stand pat, checked before the TT probe since this is where most q-nodes end
             return q_eval;
         }
+        Move tt_move = NO_MOVE;
+        Eval_Type alpha = beta - 1;
+        if (q_tt_probe(tt_move, alpha, beta)) { // I.e. if cutoff
+            return alpha; // TT entry value is put here
+        }
 
-        Movelist captures;
-        Movegen::legalmoves<CAPTURE>(board, captures);
-        for (auto& capture : captures) {
-            board.makeMove(capture.move);
+        Locked_TT_Info entry{q_eval, tt_move, (int8_t) Q_SEARCH_TT_DEPTH, UPPER_BOUND};
+        Eval_Type stand_pat = q_eval;
+        int capture_count = 0;
+        Staged_Move_Picker picker(board, tt_move);
+        for (Move capture = next_capture(picker); capture != NO_MOVE; capture = next_capture(picker)) {
+            capture_count++;
+            if (prune_capture(capture, stand_pat, alpha, q_eval)) {
+                continue;
+            }
+            make_move(capture);
             Eval_Type inner_eval = -nw_q_search(-beta + 1);
-            board.unmakeMove(capture.move);
+            unmake_move(capture);
             if (inner_eval > q_eval) {
                 q_eval = inner_eval;
+                entry.move = capture;
                 if (q_eval >= beta) {
+                    entry.type = LOWER_BOUND;
                     break;
                 }
             }
@@ -145,10 +287,13 @@ public:
             }
         }
 
+        if (capture_count > 0) { // Without captures the entry would save nothing but the move generation
+            q_tt_store(entry, q_eval);
+        }
         return q_eval;
     }
 
-    Eval_Type null_window_search(Eval_Type beta, int depth) {
+    Eval_Type null_window_search(Eval_Type beta, int depth, bool allow_null_move = true) {
         Eval_Type eval = MIN_EVAL - MAX_MATE_DEPTH;
         Move tt_move = NO_MOVE;
         Eval_Type alpha = beta - 1;
@@ -157,35 +302,48 @@ public:
         }
 
         Locked_TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        generate_shuffled_moves<ALL>(moves); // We could stop shuffling at low enough depth; won't gain much speedup,
-                                             // but if we had proper move ordering it might produce faster cutoffs
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE;
+        if constexpr (SELECTIVE) {
+            if (allow_null_move && depth >= NULL_MOVE_MIN_DEPTH && !board.in_check() && has_non_pawn_material(board)
+                && evaluate() >= beta) {
+                int null_move_depth = depth - 1 - null_move_reduction(depth);
+                make_null_move();
+                Eval_Type null_move_eval = null_move_depth > 0 ? -null_window_search(-beta + 1, null_move_depth, false)
+                                                               : -nw_q_search(-beta + 1);
+                unmake_null_move();
+                if (finished) { // The null move search got aborted, so its result means nothing
+                    return null_move_eval;
+                }
+                if (null_move_eval >= beta) { // Even passing is good enough, so some real move most likely is too
+                    selective_stats.null_move_prunes[depth]++;
+                    entry.eval = null_move_eval > MAX_EVAL ? beta : null_move_eval; // Don't trust mate scores here
+                    entry.type = LOWER_BOUND;
+                    tt.emplace(board.hashKey, entry, depth);
+                    return entry.eval;
+                }
             }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
         }
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        bool in_check = SELECTIVE && board.in_check(); // Moves out of check are never reduced
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            bool quiet = board.board[to(move)] == None;
+            make_move(move);
+            int reduction = late_move_reduction(depth, move_count, quiet, in_check);
             Eval_Type inner_eval;
             if (depth > 1) {
-                inner_eval = -null_window_search(-beta + 1, depth - 1);
+                inner_eval = -late_move_search(-beta + 1, depth - 1, reduction);
             } else {
                 inner_eval = -nw_q_search(-beta + 1);
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move;
+                entry.move = move;
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
             }
@@ -193,6 +351,12 @@ public:
                 return eval;
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -206,37 +370,31 @@ public:
         }
 
         Locked_TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        generate_shuffled_moves<ALL>(moves);
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE;
-            }
-            return eval;
-        }
-
-        int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
-        }
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        bool in_check = SELECTIVE && board.in_check(); // Moves out of check are never reduced
 
         bool search_full_window = true;
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            bool quiet = board.board[to(move)] == None;
+            make_move(move);
+            int reduction = late_move_reduction(depth, move_count, quiet, in_check);
             Eval_Type inner_eval;
             if (depth == 1) {
                 inner_eval = -q_search(-beta, -alpha);
-            } else if (search_full_window || (inner_eval = -null_window_search(-alpha, depth - 1)) > alpha){
+            } else if (search_full_window || (inner_eval = -late_move_search(-alpha, depth - 1, reduction)) > alpha){
                 inner_eval = -pv_search(-beta, -alpha, depth - 1);
                 search_full_window = false;
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move; // If it stays this way, this is the best move
+                entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -249,6 +407,12 @@ public:
                 return eval;
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -262,31 +426,25 @@ public:
         }
 
         Locked_TT_Info entry{eval, tt_move, (int8_t) depth, UPPER_BOUND}; // If we don't find a move, keep the old TT move
-        Movelist moves;
-        generate_shuffled_moves<ALL>(moves);
-
-        if (moves.size == 0) {
-            if (!board.in_check()) {
-                eval = STALEMATE_SCORE;
-            }
-            return eval;
-        }
-        // TODO why there no hashmove first here?
-        for (auto& move : moves) {
-            board.makeMove(move.move);
+        Staged_Move_Picker picker(board, tt_move);
+        int move_count = 0;
+        for (Move move = next_move(picker); move != NO_MOVE; move = next_move(picker)) {
+            move_count++;
+            make_move(move);
             Eval_Type inner_eval;
             if (depth > 1) {
                 inner_eval = -nega_max(-beta, -alpha, depth - 1);
             } else {
                 inner_eval = -q_search(-beta, -alpha);
             }
-            board.unmakeMove(move.move);
+            unmake_move(move);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
-                entry.move = move.move; // If it stays this way, this is the best move
+                entry.move = move; // If it stays this way, this is the best move
                 if (eval >= beta) {
                     entry.type = LOWER_BOUND;
+                    beta_cutoff(move, depth);
                     break;
                 }
                 if (eval > alpha) {
@@ -299,6 +457,12 @@ public:
                 return eval;
             }
         }
+        if (move_count == 0) { // No legal moves, i.e. mate or stalemate
+            if (!board.in_check()) {
+                eval = STALEMATE_SCORE[depth % 2];
+            }
+            return eval;
+        }
         entry.eval = eval;
         tt.emplace(board.hashKey, entry, depth);
         return eval;
@@ -314,11 +478,15 @@ public:
             return; // I'm claiming that if this happens, then we already have a search result from another thread so we don't need to return anything
         }
 
+        Eval_Type root_alpha = alpha; // The window might not be the full one, so the result can be a bound
         Movelist moves;
         generate_shuffled_moves<ALL>(moves);
+        if (root_order != nullptr) {
+            root_order->sort(moves); // The same order in all threads, from the previous iteration
+        }
         int tt_move_index = moves.find(tt_move);
-        if (tt_move_index > 0) {
-            std::swap(moves[0], moves[tt_move_index]); // Search the TT move first
+        if (tt_move_index > 0) { // Search the TT move first, the others keep the shared order
+            std::rotate(moves.begin(), moves.begin() + tt_move_index, moves.begin() + tt_move_index + 1);
         }
 
         Move best_move = NO_MOVE;
@@ -326,7 +494,8 @@ public:
         bool search_full_window = true;
         for (auto& move_container : moves) {
             auto move = move_container.move;
-            board.makeMove(move);
+            uint64_t nodes_before = nodes;
+            make_move(move);
             Eval_Type inner_eval;
             if (depth == 1) {
                 inner_eval = -q_search(-beta, -alpha);
@@ -342,7 +511,8 @@ public:
                 tt.print_pv(board, depth - 1);
                 tt.print_size();
             }
-            board.unmakeMove(move);
+            unmake_move(move);
+            record_root_move(move, nodes - nodes_before, inner_eval);
 
             if (inner_eval > eval) {
                 eval = inner_eval;
@@ -360,7 +530,7 @@ public:
                 return;
             }
         }
-        tt.emplace(board.hashKey, {eval, best_move, (int8_t) depth, EXACT}, depth);
+        tt.emplace(board.hashKey, {eval, best_move, (int8_t) depth, root_bound_type(eval, root_alpha, beta)}, depth);
 
         bool i_am_first = !finished.exchange(true); // Setting finished to true tells all threads to finish.
         // Surprisingly, this can lead to a slowdown at low depths, in testing up to depth 9 which does take multiple
@@ -373,41 +543,199 @@ public:
         }
         total_node_count += nodes;
     }
+
+    /**
+     * One thread of the parallel MTD(f): keeps probing the root with the betas the shared window hands out, until the
+     * bounds meet. Probes aborted because another thread made the bounds meet get thrown away.
+     */
+    void mtdf_probes(MTDF_Window& window, int depth, size_t thread_index, size_t num_threads,
+                     std::atomic<uint64_t>& total_node_count) {
+        nodes = 0;
+        Eval_Type beta;
+        while (window.next_beta(thread_index, num_threads, beta)) {
+            Eval_Type eval = null_window_search(beta, depth, false); // A null move at the root would leave us without a move
+            if (finished) {
+                break;
+            }
+            Locked_TT_Info entry{};
+            bool found = tt.get_if_exists(board.hashKey, depth, entry); // After a fail high this has the best move
+            if (window.update(beta, eval, found ? entry.move : NO_MOVE)) {
+                finished = true; // Tell the other threads to stop
+            }
+        }
+        total_node_count += nodes;
+    }
 };
 
-template<bool Q_SEARCH, TT_Strategy strategy>
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
 class Lazy_SMP {
 
     std::atomic<bool> finished = false;
     size_t num_threads;
-    std::vector<Search_Thread<Q_SEARCH, strategy>> searchers;
+    Aspiration_Stats aspiration_stats;
+    uint64_t total_nodes = 0; // Over all iterations of all searches so far
+    std::vector<Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>> searchers;
+    Board& board;
+    Locking_TT<strategy>& table;
 
+    Root_Moves root_order;
 public:
     Lazy_SMP(size_t num_threads, Board& board, Locking_TT<strategy>& table) : num_threads(num_threads),
-                    searchers(num_threads, Search_Thread<Q_SEARCH, strategy>(board, table, finished)) {
+                    searchers(num_threads, Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>(board, table, finished)),
+                    board(board), table(table),
+                    root_order(board) {
+        for (auto& searcher : searchers) {
+            searcher.set_root_order(&root_order);
+        }
+    }
+
+    [[nodiscard]] const Aspiration_Stats& get_aspiration_stats() const {
+        return aspiration_stats;
+    }
+
+    [[nodiscard]] uint64_t get_total_nodes() const {
+        return total_nodes;
     }
 
     /**
      *
      * @tparam Search_Result
      * @tparam PV_Search
+     * @tparam OUTPUT Print the result and the stats of every iteration. Bench turns this off.
      * @param up_to_depth Search for each depth from 1 to up_to_depth through iterative deepening.
      * @param iteration Optional parameter, if passed will be printed in the output. Useful for automated benchmarks.
      * @return
      */
-    template<class Search_Result, bool PV_Search>
+    template<class Search_Result, bool PV_Search, bool OUTPUT = true>
     Search_Result parallel_search(int up_to_depth, int iteration = 0) {
+        Search_Result result;
+        for (int depth = 1; depth <= up_to_depth; depth++) {
+            Aspiration_Window window(result.eval, depth); // The score of the previous iteration
+            std::atomic<uint64_t > node_count = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            do {
+                std::vector<std::thread> search_threads;
+                finished = false;
+                for (size_t i = 0; i < num_threads; i++) {
+                    auto func = std::bind(&Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>::template root_max<Search_Result, PV_Search>,
+                                          &searchers[i], window.alpha, window.beta, depth, std::ref(result), std::ref(node_count));
+                    search_threads.emplace_back(func);
+                }
+                for (auto &thread: search_threads) {
+                    thread.join();
+                }
+            } while (window.widen(result.eval, aspiration_stats));
+            root_order.next_iteration(result.move);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+
+            result.duration = duration.count();
+            result.nodes = node_count;
+            total_nodes += result.nodes;
+            if constexpr (OUTPUT) {
+                result.print_table(iteration, num_threads);
+                if constexpr (Eval_Cache::ENABLED) {
+                    print_eval_cache_stats(searchers);
+                }
+                if constexpr (Q_SEARCH) {
+                    print_q_search_stats(searchers);
+                }
+                if constexpr (SELECTIVE) {
+                    print_selective_stats(searchers, depth);
+                }
+                if (USE_ASPIRATION_WINDOWS && depth >= ASPIRATION_MIN_DEPTH) {
+                    aspiration_stats.print(depth);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Iterative deepening where the best multi_pv root moves all get exact scores. The root moves are shared by all
+     * threads and get reordered by their scores between iterations.
+     */
+    template<class Search_Result, bool PV_Search>
+    Search_Result multipv_search(int up_to_depth, size_t multi_pv) {
+        Search_Result result;
+        Root_Moves root_moves(board, multi_pv);
+        for (int depth = 1; depth <= up_to_depth && root_moves.size() > 0; depth++) {
+            root_moves.start_iteration();
+            std::atomic<uint64_t > node_count = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> search_threads;
+            finished = false;
+            for (auto& searcher : searchers) {
+                search_threads.emplace_back([&, &searcher = searcher] {
+                    searcher.template multipv_root_max<PV_Search>(root_moves, depth, node_count);
+                });
+            }
+            for (auto &thread: search_threads) {
+                thread.join();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+
+            Root_Move best = root_moves.best()[0];
+            result.move = best.move;
+            result.eval = best.score;
+            result.depth = depth;
+            result.duration = duration.count();
+            result.nodes = node_count;
+            root_moves.print(board, table, depth, result.nodes, result.duration);
+        }
+        return result;
+    }
+};
+
+/**
+ * Parallel MTD(f), every thread runs null window probes at the root with its own beta, all sharing one window of bounds.
+ */
+template<bool Q_SEARCH, TT_Strategy strategy, bool MOVE_ORDERING = true, bool SELECTIVE = false>
+class Parallel_MTDF_Search {
+
+    std::atomic<bool> finished = false;
+    size_t num_threads;
+    MTDF_Stats mtdf_stats;
+    uint64_t total_nodes = 0; // Over all iterations of all searches so far
+    std::vector<Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>> searchers;
+    Board& board;
+    Locking_TT<strategy>& table;
+
+public:
+    Parallel_MTDF_Search(size_t num_threads, Board& board, Locking_TT<strategy>& table) : num_threads(num_threads),
+                    searchers(num_threads, Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>(board, table, finished)),
+                    board(board), table(table) {
+    }
+
+    [[nodiscard]] const MTDF_Stats& get_mtdf_stats() const {
+        return mtdf_stats;
+    }
+
+    [[nodiscard]] uint64_t get_total_nodes() const {
+        return total_nodes;
+    }
+
+    /**
+     *
+     * @tparam Search_Result
+     * @tparam OUTPUT Print the result and the stats of every iteration. Bench turns this off.
+     * @param up_to_depth Search for each depth from 1 to up_to_depth through iterative deepening, each depth starting
+     * from the score of the previous one.
+     * @return
+     */
+    template<class Search_Result, bool OUTPUT = true>
+    Search_Result parallel_search(int up_to_depth) {
         Search_Result result;
         for (int depth = 1; depth <= up_to_depth; depth++) {
             std::vector<std::thread> search_threads;
-            Eval_Type alpha = MIN_EVAL - MAX_MATE_DEPTH - 1;
-            Eval_Type beta = MAX_EVAL + MAX_MATE_DEPTH + 1;
+            MTDF_Window window(result.eval);
             finished = false;
             std::atomic<uint64_t > node_count = 0;
             auto start = std::chrono::high_resolution_clock::now();
             for (size_t i = 0; i < num_threads; i++) {
-                auto func = std::bind(&Search_Thread<Q_SEARCH, strategy>::template root_max<Search_Result, PV_Search>,
-                                      &searchers[i], alpha, beta, depth, std::ref(result), std::ref(node_count));
+                auto func = std::bind(&Search_Thread<Q_SEARCH, strategy, MOVE_ORDERING, SELECTIVE>::mtdf_probes,
+                                      &searchers[i], std::ref(window), depth, i, num_threads, std::ref(node_count));
                 search_threads.emplace_back(func);
             }
             for (auto &thread: search_threads) {
@@ -416,9 +744,18 @@ public:
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> duration = end - start;
 
+            mtdf_stats.probes[depth] += window.probe_count();
+            result.move = window.move();
+            result.eval = window.value();
+            result.depth = depth;
             result.duration = duration.count();
             result.nodes = node_count;
-            result.print_table(iteration, num_threads);
+            total_nodes += result.nodes;
+            if constexpr (OUTPUT) {
+                result.print_uci();
+                table.print_pv(board, depth);
+                mtdf_stats.print(depth);
+            }
         }
         return result;
     }
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bench.h"
+
+/**
+ * Mean and the half width of its 95% confidence interval, from the Student t distribution since there are usually only
+ * a handful of trials.
+ */
+struct Sample_Stats {
+    double mean = 0;
+    double confidence = 0;
+
+    /**
+     * The two sided 95% quantile of the t distribution; from a table up to 30 degrees of freedom, beyond that from the
+     * first terms of its expansion around the normal quantile, which is exact to three decimals there.
+     */
+    static double t_quantile(size_t degrees_of_freedom) {
+        static constexpr double TABLE[30] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                              2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                              2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+        if (degrees_of_freedom <= 30) {
+            return TABLE[std::max<size_t>(degrees_of_freedom, 1) - 1];
+        }
+        double z = 1.959964, n = (double) degrees_of_freedom;
+        return z + (z * z * z + z) / (4 * n) + (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * n * n);
+    }
+
+    static Sample_Stats of(const std::vector<double>& samples) {
+        Sample_Stats stats;
+        if (samples.empty()) {
+            return stats;
+        }
+        for (double sample : samples) {
+            stats.mean += sample;
+        }
+        stats.mean /= (double) samples.size();
+        if (samples.size() > 1) {
+            double squares = 0;
+            for (double sample : samples) {
+                squares += (sample - stats.mean) * (sample - stats.mean);
+            }
+            double standard_deviation = std::sqrt(squares / (double) (samples.size() - 1));
+            stats.confidence = t_quantile(samples.size() - 1) * standard_deviation / std::sqrt((double) samples.size());
+        }
+        return stats;
+    }
+};
+
+/**
+ * Runs the parallel engines over a position set for 1, 2, 4, ... up to max_threads threads, a number of trials each,
+ * and compares every thread count with one thread of the same engine: time to depth speedup, nps scaling and search
+ * overhead, i.e. how many more nodes it takes to get to the same depth. Trial t uses seed STARTING_SEED + t for all
+ * engines and thread counts, so the trials differ in the shuffled move orders as well as in timing, and each trial
+ * gets compared with the one thread trial of the same seed.
+ * Every single search goes to <output>.raw.csv, the summary with confidence intervals to <output>.
+ */
+template<bool Q_SEARCH, TT_Strategy strategy>
+class Thread_Scaling {
+
+    struct Trial {
+        double time = 0;
+        uint64_t nodes = 0;
+    };
+
+    std::vector<std::string> positions;
+    size_t max_threads;
+    size_t trials;
+    uint64_t table_size_in_mb;
+
+    static std::string engine_name(Bench_Engine engine) {
+        switch (engine) {
+            case Bench_Engine::Search: return "search";
+            case Bench_Engine::Lazy_SMP: return "lazysmp";
+            case Bench_Engine::ABDADA: return "abdada";
+            case Bench_Engine::Simplified_ABDADA: return "simplifiedabdada";
+            case Bench_Engine::Parallel_Aspiration: return "parallelaspiration";
+            case Bench_Engine::MTDF: return "mtdf";
+            case Bench_Engine::Parallel_MTDF: return "parallelmtdf";
+        }
+        return "";
+    }
+
+    [[nodiscard]] std::vector<size_t> thread_counts() const {
+        std::vector<size_t> counts;
+        for (size_t threads = 1; threads < max_threads; threads *= 2) {
+            counts.push_back(threads);
+        }
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+public:
+    Thread_Scaling(std::vector<std::string> positions, size_t max_threads, size_t trials, uint64_t table_size_in_mb)
+            : positions(std::move(positions)), max_threads(std::max<size_t>(max_threads, 1)),
+              trials(std::max<size_t>(trials, 1)), table_size_in_mb(table_size_in_mb) {
+    }
+
+    /**
+     * Restores the seed afterwards.
+     */
+    template<class Search_Result>
+    void run(int depth, const std::string& output_file,
+             const std::vector<Bench_Engine>& engines = { Bench_Engine::Lazy_SMP, Bench_Engine::ABDADA,
+                                                          Bench_Engine::Simplified_ABDADA,
+                                                          Bench_Engine::Parallel_Aspiration }) {
+        uint64_t previous_seed = seed;
+        std::ofstream raw(output_file + ".raw.csv");
+        raw << "engine,threads,trial,position,time,nodes\n";
+        std::ofstream summary(output_file);
+        summary << "engine,threads,trials,time,time_ci,speedup,speedup_ci,nps,nps_ci,nps_scaling,nps_scaling_ci,"
+                   "overhead,overhead_ci\n";
+
+        for (Bench_Engine engine : engines) {
+            std::map<size_t, std::vector<Trial>> results; // By thread count
+            for (size_t threads : thread_counts()) {
+                Bench<Q_SEARCH, strategy> bench(engine, threads, table_size_in_mb);
+                for (size_t trial = 0; trial < trials; trial++) {
+                    Trial total;
+                    for (size_t position = 0; position < positions.size(); position++) {
+                        seed = STARTING_SEED + trial;
+                        Board board;
+                        board.applyFen(positions[position]);
+                        double duration = 0;
+                        uint64_t nodes = bench.template search_position<Search_Result>(board, depth, duration);
+                        raw << engine_name(engine) << "," << threads << "," << trial << "," << position << ","
+                            << duration << "," << nodes << "\n";
+                        total.time += duration;
+                        total.nodes += nodes;
+                    }
+                    results[threads].push_back(total);
+                }
+            }
+
+            // Trial t with n threads gets compared with trial t with one thread, which ran with the same seed. The
+            // ratios of the pairs are independent samples, so their confidence intervals cover the variance of both.
+            const std::vector<Trial>& single_trials = results[1];
+            std::cout << "engine\tthreads\tspeedup\tnps scaling\toverhead" << std::endl;
+            for (const auto& [threads, thread_trials] : results) {
+                std::vector<double> times, speedups, nps, nps_scalings, overheads;
+                for (size_t trial = 0; trial < thread_trials.size(); trial++) {
+                    const Trial& single = single_trials[trial];
+                    const Trial& parallel = thread_trials[trial];
+                    times.push_back(parallel.time);
+                    speedups.push_back(single.time / parallel.time);
+                    nps.push_back((double) parallel.nodes / parallel.time);
+                    nps_scalings.push_back(nps.back() / ((double) single.nodes / single.time));
+                    overheads.push_back((double) parallel.nodes / (double) single.nodes - 1);
+                }
+                auto time_stats = Sample_Stats::of(times), speedup_stats = Sample_Stats::of(speedups),
+                        nps_stats = Sample_Stats::of(nps), nps_scaling_stats = Sample_Stats::of(nps_scalings),
+                        overhead_stats = Sample_Stats::of(overheads);
+                summary << engine_name(engine) << "," << threads << "," << thread_trials.size() << ","
+                        << time_stats.mean << "," << time_stats.confidence << "," << speedup_stats.mean << ","
+                        << speedup_stats.confidence << "," << nps_stats.mean << "," << nps_stats.confidence << ","
+                        << nps_scaling_stats.mean << "," << nps_scaling_stats.confidence << "," << overhead_stats.mean
+                        << "," << overhead_stats.confidence << "\n";
+                std::cout << engine_name(engine) << "\t" << threads << "\t" << speedup_stats.mean << " +- "
+                          << speedup_stats.confidence << "\t" << nps_scaling_stats.mean << " +- "
+                          << nps_scaling_stats.confidence << "\t" << overhead_stats.mean << " +- "
+                          << overhead_stats.confidence << std::endl;
+            }
+        }
+        seed = previous_seed;
+    }
+};
@@ -2,9 +2,21 @@
 
 #include <iostream>
 #include <string>
+#include <fstream>
 
 #include "chess.hpp"
 #include "simplified_abdada.h"
+#include "mate_search.h"
+#include "mcts.h"
+#include "multi_seed_search.h"
+#include "seed_sweep.h"
+#include "parallel_perft.h"
+#include "perft_suite.h"
+#include "persistent_perft.h"
+#include "distributed_perft.h"
+#include "unique_perft.h"
+#include "bench.h"
+#include "thread_scaling.h"
 
 
 struct Search_Result {
@@ -25,6 +37,11 @@ struct Search_Result {
 
     }
 
+    void print_table(int iteration, size_t num_threads) const {
+        std::cout << iteration << "\t" << num_threads << "\t" << depth << "\t" << duration << "\t" << (nodes / duration)
+                  << "\t" << eval << "\t" << nodes << std::endl;
+    }
+
     void print_uci() const {
         int millis = (int) (duration * 1000);
         std::cout << "info depth " << depth << " score cp " << eval / 100 << " time " << millis << " nodes " << nodes
@@ -35,6 +52,7 @@ struct Search_Result {
 class UCI {
     Board board;
     Locking_TT<REPLACE_LAST_ENTRY> table{256}; // TODO depend on default depth
+    size_t multi_pv = 1;
 
 public:
     void uci_loop() {
@@ -42,7 +60,10 @@ public:
         constexpr bool q_search = false;
         while (getline(std::cin, command), command != "quit") {
             if (command == "uci") {
+                std::cout << "option name MultiPV type spin default 1 min 1 max 256" << std::endl;
                 std::cout << "uciok" << std::endl;
+            } else if (command.starts_with("setoption name MultiPV value ")) {
+                multi_pv = std::clamp(std::stoi(command.substr(29)), 1, 256);
             } else if (command == "isready") {
                 std::cout << "readyok" << std::endl;
             } else if (command == "ucinewgame") {
@@ -64,7 +85,75 @@ public:
                 table.clear();
                 int depth = std::stoi(command.substr(8));
                 Simplified_ABDADA_Search<q_search, REPLACE_LAST_ENTRY> search(10, board, table);
-                search.parallel_search<Search_Result, true>(depth);
+                if (multi_pv > 1) {
+                    search.multipv_search<Search_Result, true>(depth, multi_pv);
+                } else {
+                    search.parallel_search<Search_Result, true>(depth);
+                }
+            } else if (command.starts_with("go mate")) {
+                int mate_in_moves = std::stoi(command.substr(7));
+                Mate_Search search(board, 256);
+                auto result = search.solve(mate_in_moves, 10);
+                if (result.proven) {
+                    result.print_uci();
+                } else {
+                    std::cout << "info string no mate in " << mate_in_moves << " found" << std::endl;
+                }
+                std::cout << "bestmove " << (result.line.empty() ? "0000" : convertMoveToUci(result.line[0]))
+                          << std::endl;
+            } else if (command.starts_with("go mcts movetime")) {
+                int millis = std::stoi(command.substr(16));
+                randomize_seed();
+                MCTS_Arena arena(256);
+                MCTS_Search search(10, board, arena);
+                auto result = search.search<Search_Result>(millis / 1000.0);
+                std::cout << "bestmove " << convertMoveToUci(result.move) << std::endl;
+            } else if (command.starts_with("go multiseed depth")) {
+                int depth = std::stoi(command.substr(18));
+                Multi_Seed_Search search(board, seed); // The current seed and the ones after it
+                search.search<Search_Result>(depth, true);
+            } else if (command.starts_with("seedsweep ")) { // seedsweep <fen file> <seeds> <depth> <workers> <output>
+                auto arguments = splitInput(command.substr(10));
+                std::ifstream fen_file(arguments[0]);
+                std::vector<std::string> positions;
+                for (std::string fen; getline(fen_file, fen);) {
+                    if (!fen.empty()) {
+                        positions.push_back(fen);
+                    }
+                }
+                Seed_Sweep<q_search, REPLACE_LAST_ENTRY> sweep(positions, std::stoi(arguments[3]), 64, arguments[4]);
+                sweep.run<Search_Result>(seed, std::stoull(arguments[1]), std::stoi(arguments[2]),
+                                         arguments[4] + ".moves.csv");
+            } else if (command.starts_with("perft suite ")) { // perft suite <epd file> <max depth> <seconds> <json output>
+                auto arguments = splitInput(command.substr(12));
+                Perft_TT perft_table(256);
+                run_perft_suite(arguments[0], std::stoi(arguments[1]), std::stod(arguments[2]), arguments[3],
+                                perft_table);
+            } else if (command.starts_with("perft parallel ")) { // perft parallel <depth> <threads> [split depth]
+                auto arguments = splitInput(command.substr(15));
+                Perft_TT perft_table(256);
+                Parallel_Perft parallel_perft(perft_table, std::stoul(arguments[1]),
+                                              arguments.size() > 2 ? std::stoi(arguments[2]) : 1);
+                parallel_perft.perft(board, std::stoi(arguments[0]));
+            } else if (command.starts_with("perft persistent ")) { // perft persistent <file> <depth> <threads> <hash mb>
+                auto arguments = splitInput(command.substr(17));
+                Persistent_Perft persistent_perft(arguments[0], std::stoull(arguments[3]));
+                persistent_perft.perft(board, std::stoi(arguments[1]), std::stoul(arguments[2]));
+            } else if (command.starts_with("perft coordinate ")) { // perft coordinate <spool dir> <depth> <split depth>
+                auto arguments = splitInput(command.substr(17));
+                Perft_Coordinator coordinator(arguments[0]);
+                coordinator.perft(board, std::stoi(arguments[1]), std::stoi(arguments[2]));
+            } else if (command.starts_with("perft worker ")) { // perft worker <spool dir> <threads> <hash mb>
+                auto arguments = splitInput(command.substr(13));
+                Perft_Worker worker(arguments[0], std::stoull(arguments[2]));
+                worker.run(std::stoul(arguments[1]));
+            } else if (command.starts_with("perft unique ")) { // perft unique <max depth> <threads> <hash mb> [spill dir]
+                auto arguments = splitInput(command.substr(13));
+                Unique_Perft unique_perft(std::stoull(arguments[2]), 256, arguments.size() > 3 ? arguments[3] : "");
+                unique_perft.print_unique_positions(board, std::stoi(arguments[0]), std::stoul(arguments[1]));
+            } else if (command.starts_with("perft ")) {
+                Perft_TT perft_table(256);
+                perft_divide(board, std::stoi(command.substr(6)), perft_table);
             } else if (command.starts_with("go movetime")) {
                 table.clear();
                 int depth = DEFAULT_DEPTH;
@@ -72,6 +161,45 @@ public:
                 Simplified_ABDADA_Search<q_search, REPLACE_LAST_ENTRY> search(10, board, table);
                 auto result = search.parallel_search<Search_Result, true>(depth);
                 std::cout << "bestmove " << convertMoveToUci(result.move) << std::endl;
+            } else if (command == "bench" || command.starts_with("bench ")) { // bench [depth D] [threads T] [hash MB] [engine E]
+                auto arguments = splitInput(command.substr(5));
+                int depth = BENCH_DEPTH;
+                size_t threads = 1;
+                uint64_t hash = 16;
+                std::optional<Bench_Engine> engine = Bench_Engine::Search;
+                for (size_t i = 0; i + 1 < arguments.size() && engine; i += 2) {
+                    if (arguments[i] == "depth") {
+                        depth = std::stoi(arguments[i + 1]);
+                    } else if (arguments[i] == "threads") {
+                        threads = std::stoul(arguments[i + 1]);
+                    } else if (arguments[i] == "hash") {
+                        hash = std::stoull(arguments[i + 1]);
+                    } else if (arguments[i] == "engine") {
+                        engine = parse_bench_engine(arguments[i + 1]);
+                        if (!engine) {
+                            std::cout << "info string unknown bench engine " << arguments[i + 1] << std::endl;
+                        }
+                    }
+                }
+                if (engine) {
+                    Bench<q_search, REPLACE_LAST_ENTRY> bench(*engine, threads, hash);
+                    bench.run<Search_Result>(depth);
+                }
+            } else if (command.starts_with("threadscaling ")) { // threadscaling <max threads> <trials> <depth> <output> [fen file]
+                auto arguments = splitInput(command.substr(14));
+                std::vector<std::string> positions = BENCH_POSITIONS;
+                if (arguments.size() > 4) {
+                    positions.clear();
+                    std::ifstream fen_file(arguments[4]);
+                    for (std::string fen; getline(fen_file, fen);) {
+                        if (!fen.empty()) {
+                            positions.push_back(fen);
+                        }
+                    }
+                }
+                Thread_Scaling<q_search, REPLACE_LAST_ENTRY> scaling(positions, std::stoul(arguments[0]),
+                                                                     std::stoul(arguments[1]), 64);
+                scaling.run<Search_Result>(std::stoi(arguments[2]), arguments[3]);
             } else if (command == "selfplay") {
                 std::string full_game;
                 int depth = 9;
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "perft.h"
+
+/**
+ * Open addressed set of hash keys with linear probing, where an insert is a CAS on an empty slot, so any number of
+ * threads can insert at the same time without locks. Key 0 marks an empty slot, a key that really is 0 gets stored as 1.
+ * It doesn't grow by itself; the owner has to check the load and grow or empty it while nobody inserts. An insert gives
+ * up after MAX_PROBES slots, so threads that together push the set past its load limit, or fill it, can't spin forever.
+ */
+class Concurrent_Key_Set {
+
+    static constexpr uint64_t EMPTY_SLOT = 0;
+    static constexpr uint64_t MAX_PROBES = 4096; // Far beyond the longest runs below the load limit
+
+    std::vector<std::atomic<uint64_t>> slots;
+    uint64_t mask;
+    std::atomic<uint64_t> count = 0;
+
+public:
+    explicit Concurrent_Key_Set(uint64_t size_in_mb)
+            : slots((1 << 20) * std::bit_floor(std::max<uint64_t>(size_in_mb, 1)) / sizeof(uint64_t)),
+              mask(slots.size() - 1) {
+    }
+
+    /**
+     * @return false if the key didn't fit, then the owner has to make room and insert it again.
+     */
+    bool insert(uint64_t key) {
+        key = key == EMPTY_SLOT ? 1 : key;
+        uint64_t slot = (key * 0x9E3779B97F4A7C15ULL) >> 20 & mask;
+        for (uint64_t probe = 0; probe < MAX_PROBES; probe++, slot = (slot + 1) & mask) {
+            uint64_t stored = slots[slot].load(std::memory_order_relaxed);
+            if (stored == EMPTY_SLOT && slots[slot].compare_exchange_strong(stored, key, std::memory_order_relaxed)) {
+                count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (stored == key) { // Either it was there already, or another thread won the CAS with the same key
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Three quarters full; with linear probing it gets slow beyond that.
+     */
+    [[nodiscard]] bool over_load_limit() const {
+        return count.load(std::memory_order_relaxed) * 4 > slots.size() * 3;
+    }
+
+    [[nodiscard]] uint64_t size() const {
+        return count;
+    }
+
+    [[nodiscard]] uint64_t size_in_bytes() const {
+        return slots.size() * sizeof(uint64_t);
+    }
+
+    /**
+     * Not thread safe, like the other methods below.
+     */
+    [[nodiscard]] std::vector<uint64_t> sorted_keys() const {
+        std::vector<uint64_t> keys;
+        keys.reserve(count);
+        for (const auto& slot : slots) {
+            if (slot != EMPTY_SLOT) {
+                keys.push_back(slot);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+
+    void grow() {
+        std::vector<uint64_t> keys = sorted_keys();
+        slots = std::vector<std::atomic<uint64_t>>(2 * slots.size());
+        mask = slots.size() - 1;
+        count = 0;
+        for (uint64_t key : keys) {
+            [[maybe_unused]] bool fits = insert(key);
+            assert(fits); // At most half the load limit now
+        }
+    }
+
+    void clear() {
+        for (auto& slot : slots) {
+            slot = EMPTY_SLOT;
+        }
+        count = 0;
+    }
+};
+
+/**
+ * Counts the distinct positions, by hash key, at every depth up to the given one, instead of the paths to them. The leaf
+ * keys go into a Concurrent_Key_Set, buffered per thread. A perft table remembers which positions got expanded to which
+ * remaining depth already: those have all their leaves in the set, so a transposition doesn't need to be searched again.
+ * That table may lose entries, which only costs time.
+ * If the key set fills up it either doubles in size or, with a spill directory, gets written to disk as a sorted run and
+ * emptied; the runs get merged at the end of the depth.
+ */
+class Unique_Perft {
+
+    static constexpr size_t FLUSH_SIZE = 1024; // Leaf keys a thread buffers before it inserts them
+
+    Concurrent_Key_Set leaves;
+    Perft_TT expanded;
+    uint64_t expanded_bytes;
+    std::string spill_directory;
+    std::shared_mutex resize_lock; // Shared for inserting, exclusive for growing or spilling
+    uint64_t resizes = 0; // Times the set grew or got spilled, guarded by resize_lock
+    std::vector<std::filesystem::path> runs;
+    uint64_t spilled_bytes = 0;
+    uint64_t peak_set_bytes = 0;
+
+    void spill(int depth) {
+        auto keys = leaves.sorted_keys();
+        auto run = std::filesystem::path(spill_directory)
+                   / ("unique_" + std::to_string(depth) + "_" + std::to_string(runs.size()) + ".run");
+        std::ofstream(run, std::ios::binary).write(reinterpret_cast<const char*>(keys.data()),
+                                                   (std::streamsize) (keys.size() * sizeof(uint64_t)));
+        runs.push_back(run);
+        spilled_bytes += keys.size() * sizeof(uint64_t);
+        leaves.clear();
+    }
+
+    /**
+     * Makes room whenever the set is over its load limit, or an insert didn't fit, and then inserts the rest.
+     */
+    void flush(std::vector<uint64_t>& buffer, int depth) {
+        size_t inserted = 0;
+        while (true) {
+            uint64_t resizes_before;
+            {
+                std::shared_lock<std::shared_mutex> guard(resize_lock);
+                resizes_before = resizes;
+                while (inserted < buffer.size() && leaves.insert(buffer[inserted])) {
+                    inserted++;
+                }
+            }
+            bool full = inserted < buffer.size();
+            if (full || leaves.over_load_limit()) {
+                std::unique_lock<std::shared_mutex> guard(resize_lock);
+                // Unless another thread already made room
+                if ((full && resizes == resizes_before) || leaves.over_load_limit()) {
+                    if (spill_directory.empty()) {
+                        leaves.grow();
+                        peak_set_bytes = std::max(peak_set_bytes, leaves.size_in_bytes());
+                    } else {
+                        spill(depth);
+                    }
+                    resizes++;
+                }
+            }
+            if (!full) {
+                break;
+            }
+        }
+        buffer.clear();
+    }
+
+    void collect(Board& board, int remaining, int depth, std::vector<uint64_t>& buffer) {
+        if (remaining == 0) {
+            buffer.push_back(board.hashKey);
+            if (buffer.size() >= FLUSH_SIZE) {
+                flush(buffer, depth);
+            }
+            return;
+        }
+        uint64_t unused;
+        if (expanded.get_if_exists(board.hashKey, remaining, unused)) {
+            return;
+        }
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (int i = 0; i < moves.size; i++) {
+            Move move = moves[i].move;
+            board.makeMove(move);
+            collect(board, remaining - 1, depth, buffer);
+            board.unmakeMove(move);
+        }
+        expanded.emplace(board.hashKey, remaining, 1); // Only now, before that not all leaves are in
+    }
+
+    /**
+     * Merges the sorted runs and whatever is left in the set, counting every key once.
+     */
+    uint64_t merge_runs(int depth) {
+        if (runs.empty()) {
+            return leaves.size();
+        }
+        spill(depth);
+        using Head = std::pair<uint64_t, size_t>; // Next key of a run and the run
+        std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+        std::vector<std::ifstream> files;
+        for (size_t i = 0; i < runs.size(); i++) {
+            files.emplace_back(runs[i], std::ios::binary);
+            uint64_t key;
+            if (files[i].read(reinterpret_cast<char*>(&key), sizeof(key))) {
+                heads.emplace(key, i);
+            }
+        }
+        uint64_t unique = 0;
+        uint64_t last_key = 0;
+        while (!heads.empty()) {
+            auto [key, run] = heads.top();
+            heads.pop();
+            if (unique == 0 || key != last_key) {
+                unique++;
+                last_key = key;
+            }
+            if (files[run].read(reinterpret_cast<char*>(&key), sizeof(key))) {
+                heads.emplace(key, run);
+            }
+        }
+        for (const auto& run : runs) {
+            std::filesystem::remove(run);
+        }
+        runs.clear();
+        return unique;
+    }
+
+public:
+    /**
+     * @param spill_directory Empty to keep everything in memory, growing the key set as needed.
+     */
+    Unique_Perft(uint64_t set_size_in_mb, uint64_t table_size_in_mb, std::string spill_directory = "")
+            : leaves(set_size_in_mb), expanded(table_size_in_mb),
+              expanded_bytes((1 << 20) * std::bit_floor(std::max<uint64_t>(table_size_in_mb, 1))),
+              spill_directory(std::move(spill_directory)) {
+    }
+
+    uint64_t unique_positions(Board& board, int depth, size_t num_threads) {
+        leaves.clear();
+        expanded.clear();
+        peak_set_bytes = leaves.size_in_bytes();
+        std::vector<Move> root_moves;
+        Movelist moves;
+        Movegen::legalmoves<ALL>(board, moves);
+        for (int i = 0; i < moves.size; i++) {
+            root_moves.push_back(moves[i].move);
+        }
+
+        if (depth == 0) {
+            leaves.insert(board.hashKey);
+        } else {
+            std::atomic<size_t> next_move = 0;
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < std::max<size_t>(num_threads, 1); t++) {
+                threads.emplace_back([&, root = board]() mutable {
+                    std::vector<uint64_t> buffer;
+                    for (size_t i = next_move++; i < root_moves.size(); i = next_move++) {
+                        root.makeMove(root_moves[i]);
+                        collect(root, depth - 1, depth, buffer);
+                        root.unmakeMove(root_moves[i]);
+                    }
+                    flush(buffer, depth);
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+        return merge_runs(depth);
+    }
+
+    /**
+     * The distinct position count for every depth up to max_depth, with the memory it took.
+     */
+    void print_unique_positions(Board& board, int max_depth, size_t num_threads) {
+        std::cout << "depth\tunique positions\ttime\tkey set MB\texpanded table MB\tspilled MB" << std::endl;
+        for (int depth = 0; depth <= max_depth; depth++) {
+            spilled_bytes = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            uint64_t unique = unique_positions(board, depth, num_threads);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            std::cout << depth << "\t" << unique << "\t" << duration.count() << "\t" << peak_set_bytes / (1 << 20)
+                      << "\t" << expanded_bytes / (1 << 20) << "\t" << spilled_bytes / (1 << 20) << std::endl;
+        }
+    }
+};